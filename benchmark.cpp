@@ -1,15 +1,39 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <new>
 #include <string>
 #include <vector>
 
 #include "ColGenModel.hpp"
 #include "CompactModel.hpp"
 #include "DivingHeuristic.hpp"
+#include "KnapsackKernel.hpp"
 using namespace std;
 namespace fs = std::filesystem;
 
+// Count every heap allocation of the program (used to measure the allocations made by the pricing)
+atomic<long> nb_allocations = 0;
+
+void* operator new(size_t size) {
+    nb_allocations++;
+    if (void* ptr = malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
 vector<string> getSortedFiles(string data_folder) {
     // Done with the help of an LLM
     vector<string> file_paths;
@@ -49,24 +73,34 @@ vector<string> getSortedFiles(string data_folder) {
     return file_paths;
 }
 
-vector<string> getValidInstances(vector<string> file_paths) {
-    vector<string> valid_instances;
+// Instance loaded once and shared by all the benchmarks (name is the file name without extension)
+struct BenchmarkInstance {
+    string name;
+    Instance inst;
+};
+
+vector<BenchmarkInstance> getValidInstances(vector<string> file_paths) {
+    vector<BenchmarkInstance> valid_instances;
     for (const string& file_path : file_paths) {
         string file_name_clean = fs::path(file_path).stem().string();
 
-        ifstream inst_file(file_path);
+        // The distances aren't needed to check feasibility, they are only computed for the valid instances
         Instance inst;
-        inst_file >> inst;
+        if (!inst.loadFromFile(file_path, false)) {
+            cout << "Instance " << file_name_clean << " couldn't be read : SKIPPING" << endl;
+            continue;
+        }
         if (!inst.isFeasible()) {
             cout << "Instance " << file_name_clean << " is infeasible : SKIPPING" << endl;
             continue;
         }
-        valid_instances.push_back(file_path);
+        inst.buildDistanceMatrix();
+        valid_instances.push_back({file_name_clean, std::move(inst)});
     }
     return valid_instances;
 }
 
-void compactModelResults(vector<string> file_paths, string csv_file, int time_limit) {
+void compactModelResults(vector<BenchmarkInstance>& instances, string csv_file, int time_limit) {
     // Create csv file
     ofstream file(csv_file);
     if (!file.is_open()) {
@@ -77,17 +111,14 @@ void compactModelResults(vector<string> file_paths, string csv_file, int time_li
     file << "Instance;Opt Found?;Best Sol;Dual Bound;Gap;Duration(s); Relax Sol; Relax Gap; Duration(s)" << endl;
     cout << "=== STARTING COMPACT MODEL BENCHMARK ===" << endl;
 
-    for (const string& file_path : file_paths) {
+    for (BenchmarkInstance& instance : instances) {
         // Remove
-        string file_name_clean = fs::path(file_path).stem().string();
+        string file_name_clean = instance.name;
 
         cout << "Solving instance : " << file_name_clean << " ... " << flush;
 
         try {
-            // Loading instance
-            ifstream inst_file(file_path);
-            Instance inst;
-            inst_file >> inst;
+            Instance& inst = instance.inst;  // already loaded by getValidInstances
 
             // Solve instance
             CompactModel solver(inst);
@@ -140,7 +171,7 @@ void compactModelResults(vector<string> file_paths, string csv_file, int time_li
     cout << "=== END OF BENCHMARK. Results are in " << csv_file << " ===" << endl;
 }
 
-void singleVsMulti(vector<string> file_paths, string csv_file, int time_limit) {
+void singleVsMulti(vector<BenchmarkInstance>& instances, string csv_file, int time_limit) {
     // Create csv file
     ofstream file(csv_file);
     if (!file.is_open()) {
@@ -151,17 +182,14 @@ void singleVsMulti(vector<string> file_paths, string csv_file, int time_limit) {
     file << "Instance;SINGLE Value;Nb cols; Durations(s);MULTI Value;Nb cols;Duration(s)" << endl;
     cout << "=== STARTING COLUMN STRATEGY BENCHMARK ===" << endl;
 
-    for (const string& file_path : file_paths) {
+    for (BenchmarkInstance& instance : instances) {
         // Remove
-        string file_name_clean = fs::path(file_path).stem().string();
+        string file_name_clean = instance.name;
 
         cout << "Solving instance : " << file_name_clean << " ... " << flush;
 
         try {
-            // Loading instance
-            ifstream inst_file(file_path);
-            Instance inst;
-            inst_file >> inst;
+            Instance& inst = instance.inst;  // already loaded by getValidInstances
 
             // Solve SINGLE instance
             ColGenModel single_solver(inst, PricingMethod::MIP, ColumnStrategy::SINGLE);
@@ -194,7 +222,7 @@ void singleVsMulti(vector<string> file_paths, string csv_file, int time_limit) {
     cout << "=== END OF BENCHMARK. Results are in " << csv_file << " ===" << endl;
 }
 
-void comparePricingMethods(vector<string> file_paths, string csv_file, int time_limit) {
+void comparePricingMethods(vector<BenchmarkInstance>& instances, string csv_file, int time_limit) {
     // Create csv file
     ofstream file(csv_file);
     if (!file.is_open()) {
@@ -205,17 +233,14 @@ void comparePricingMethods(vector<string> file_paths, string csv_file, int time_
     file << "Instance;MIP Value;Nb cols; Durations(s);DP Value;Nb cols;Duration(s)" << endl;
     cout << "=== STARTING PRICING METHOD BENCHMARK ===" << endl;
 
-    for (const string& file_path : file_paths) {
+    for (BenchmarkInstance& instance : instances) {
         // Remove
-        string file_name_clean = fs::path(file_path).stem().string();
+        string file_name_clean = instance.name;
 
         cout << "Solving instance : " << file_name_clean << " ... " << flush;
 
         try {
-            // Loading instance
-            ifstream inst_file(file_path);
-            Instance inst;
-            inst_file >> inst;
+            Instance& inst = instance.inst;  // already loaded by getValidInstances
 
             // Solve MIP instance
             ColGenModel mip_solver(inst, PricingMethod::MIP, ColumnStrategy::MULTI);
@@ -249,7 +274,7 @@ void comparePricingMethods(vector<string> file_paths, string csv_file, int time_
     cout << "=== END OF BENCHMARK. Results are in " << csv_file << " ===" << endl;
 }
 
-void compareWithAndWithoutStabilization(vector<string> file_paths, string csv_file, int time_limit) {
+void compareWithAndWithoutStabilization(vector<BenchmarkInstance>& instances, string csv_file, int time_limit) {
     // Create csv file
     ofstream file(csv_file);
     if (!file.is_open()) {
@@ -260,17 +285,14 @@ void compareWithAndWithoutStabilization(vector<string> file_paths, string csv_fi
     file << "Instance;NOSTAB Value;Nb cols; Durations(s);INOUT Value;Nb cols;Duration(s)" << endl;
     cout << "=== STARTING STABILIZATION BENCHMARK ===" << endl;
 
-    for (const string& file_path : file_paths) {
+    for (BenchmarkInstance& instance : instances) {
         // Remove
-        string file_name_clean = fs::path(file_path).stem().string();
+        string file_name_clean = instance.name;
 
         cout << "Solving instance : " << file_name_clean << " ... " << flush;
 
         try {
-            // Loading instance
-            ifstream inst_file(file_path);
-            Instance inst;
-            inst_file >> inst;
+            Instance& inst = instance.inst;  // already loaded by getValidInstances
 
             // Solve no stabilization instance
             ColGenModel none_solver(inst, PricingMethod::DP, ColumnStrategy::MULTI, Stabilization::NONE);
@@ -304,7 +326,54 @@ void compareWithAndWithoutStabilization(vector<string> file_paths, string csv_fi
     cout << "=== END OF BENCHMARK. Results are in " << csv_file << " ===" << endl;
 }
 
-void divingHeuristicResults(vector<string> file_paths, string csv_file, int time_limit) {
+void compareStabilizations(vector<BenchmarkInstance>& instances, string csv_file, int time_limit) {
+    // Create csv file
+    ofstream file(csv_file);
+    if (!file.is_open()) {
+        cerr << "Error : Couldn't create file " << csv_file << endl;
+        return;
+    }
+
+    vector<pair<string, Stabilization>> stabilizations = {
+        {"NONE", Stabilization::NONE}, {"INOUT", Stabilization::INOUT}, {"ADAPTIVE", Stabilization::ADAPTIVE}, {"BOXSTEP", Stabilization::BOXSTEP}};
+    file << "Instance";
+    for (const auto& [name, stabilization] : stabilizations) {
+        file << ";" << name << " Value;Iterations;Nb cols;Duration(s)";
+    }
+    file << endl;
+    cout << "=== STARTING STABILIZATION MODES BENCHMARK ===" << endl;
+
+    for (BenchmarkInstance& instance : instances) {
+        string file_name_clean = instance.name;
+
+        cout << "Solving instance : " << file_name_clean << " ... " << flush;
+
+        try {
+            Instance& inst = instance.inst;  // already loaded by getValidInstances
+
+            file << file_name_clean;
+            double total_runtime = 0.0;
+            for (const auto& [name, stabilization] : stabilizations) {
+                ColGenModel solver(inst, PricingMethod::DP, ColumnStrategy::MULTI, stabilization);
+                int nb_cols = solver.solve(time_limit);
+                bool TLR = solver.runtime > time_limit;  // TLR:time limit reached
+                total_runtime += solver.runtime;
+                file << ";" << fixed << setprecision(4) << solver.obj() << (TLR ? "(TLR)" : "") << ";" << solver.nb_iterations << ";" << nb_cols << ";"
+                     << fixed << setprecision(2) << solver.runtime;
+            }
+            file << endl;
+
+            cout << "DONE! (" << total_runtime << "s)" << endl;
+        } catch (...) {
+            cerr << "Unknown error on " << file_name_clean << endl;
+            file << file_name_clean << ";CRASH" << endl;
+        }
+    }
+    file.close();
+    cout << "=== END OF BENCHMARK. Results are in " << csv_file << " ===" << endl;
+}
+
+void divingHeuristicResults(vector<BenchmarkInstance>& instances, string csv_file, int time_limit) {
     // Create csv file
     ofstream file(csv_file);
     if (!file.is_open()) {
@@ -315,17 +384,14 @@ void divingHeuristicResults(vector<string> file_paths, string csv_file, int time
     file << "Instance;Best Sol;Duration(s)" << endl;
     cout << "=== STARTING DIVING HEURISTIC BENCHMARK ===" << endl;
 
-    for (const string& file_path : file_paths) {
+    for (BenchmarkInstance& instance : instances) {
         // Remove
-        string file_name_clean = fs::path(file_path).stem().string();
+        string file_name_clean = instance.name;
 
         cout << "Solving instance : " << file_name_clean << " ... " << flush;
 
         try {
-            // Loading instance
-            ifstream inst_file(file_path);
-            Instance inst;
-            inst_file >> inst;
+            Instance& inst = instance.inst;  // already loaded by getValidInstances
 
             // Solve instance
             ColGenModel model(inst, PricingMethod::DP, ColumnStrategy::MULTI, Stabilization::INOUT);
@@ -353,7 +419,7 @@ void divingHeuristicResults(vector<string> file_paths, string csv_file, int time
             }
 
             // Create sol and visualizer files
-            exportSolution(sol, file_name_clean);
+            exportSolution(inst, sol, file_name_clean);
             model.inst.visualize(sol, file_name_clean);
             double best_sol = model.model->get(GRB_DoubleAttr_ObjVal);
             double runtime = solver.runtime;
@@ -370,13 +436,65 @@ void divingHeuristicResults(vector<string> file_paths, string csv_file, int time
     file.close();
     cout << "=== END OF BENCHMARK. Results are in " << csv_file << " ===" << endl;
 }
+
+void pricingAllocations(vector<BenchmarkInstance>& instances, string csv_file, int nb_rounds) {
+    // Create csv file
+    ofstream file(csv_file);
+    if (!file.is_open()) {
+        cerr << "Error : Couldn't create file " << csv_file << endl;
+        return;
+    }
+
+    file << "Instance;Nb sub problems;Allocations per sub problem;Time per sub problem(us)" << endl;
+    cout << "=== STARTING PRICING ALLOCATIONS BENCHMARK ===" << endl;
+    cout << "Knapsack kernel used : " << KnapsackKernel::implementationName() << endl;
+
+    for (BenchmarkInstance& instance : instances) {
+        string file_name_clean = instance.name;
+
+        cout << "Solving instance : " << file_name_clean << " ... " << flush;
+
+        try {
+            Instance& inst = instance.inst;  // already loaded by getValidInstances
+
+            // Single thread so we only measure the pricing itself
+            ColGenModel model(inst, PricingMethod::DP, ColumnStrategy::MULTI, Stabilization::NONE, false, 1);
+            double theta = model.getTheta();
+            const vector<double>& pi = model.getPi();
+
+            // Solve the same pricing problems several times and count the allocations made
+            long allocations_before = nb_allocations;
+            auto start = chrono::high_resolution_clock::now();
+            for (int round = 0; round < nb_rounds; round++) {
+                model.solveSubProblems(theta, pi);
+            }
+            chrono::duration<double> time_elapsed = chrono::high_resolution_clock::now() - start;
+            long allocations = nb_allocations - allocations_before;
+            int nb_sub_problems = nb_rounds * inst.nb_potential_facilities;
+
+            // Write in csv file
+            file << file_name_clean << ";" << nb_sub_problems << ";" << fixed << setprecision(2) << (double)allocations / nb_sub_problems << ";"
+                 << fixed << setprecision(2) << time_elapsed.count() * 1e6 / nb_sub_problems << endl;
+            cout << "DONE! (" << time_elapsed.count() << "s)" << endl;
+        } catch (GRBException& e) {
+            cerr << "GUROBI error : " << e.getMessage() << endl;
+            file << file_name_clean << ";ERROR;;" << endl;
+        }
+    }
+    file.close();
+    cout << "=== END OF BENCHMARK. Results are in " << csv_file << " ===" << endl;
+}
+
 int main(int argc, char** argv) {
     vector<string> file_paths = getSortedFiles("../instances");
-    vector<string> valid_paths = getValidInstances(file_paths);
-    // compactModelResults(valid_paths, "compact_model.csv", 600);
-    //   singleVsMulti(file_paths, "single_vs_multi.csv", 60);
-    //   comparePricingMethods(file_paths, "pricing_method.csv", 60);
-    //  compareWithAndWithoutStabilization(valid_paths, "with_without_stabilization.csv", 60);
-    // divingHeuristicResults(valid_paths, "diving_heuristic.csv", 60);
+    // Each file is parsed once, here
+    vector<BenchmarkInstance> instances = getValidInstances(file_paths);
+    // compactModelResults(instances, "compact_model.csv", 600);
+    //   singleVsMulti(instances, "single_vs_multi.csv", 60);
+    //   comparePricingMethods(instances, "pricing_method.csv", 60);
+    //  compareWithAndWithoutStabilization(instances, "with_without_stabilization.csv", 60);
+    // compareStabilizations(instances, "stabilization_modes.csv", 60);
+    // divingHeuristicResults(instances, "diving_heuristic.csv", 60);
+    // pricingAllocations(instances, "pricing_allocations.csv", 100);
     return 1;
 }
@@ -0,0 +1,85 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "BranchAndPrice.hpp"
+#include "ColGenModel.hpp"
+#include "Instance.hpp"
+using namespace std;
+
+void usage(const string& prog_name) {
+    cout << "Usage: " << prog_name << " file_path [time_limit] [-t nb_threads] [-v]" << endl;
+    cout << "  file_path       : path to the input instance file" << endl;
+    cout << "  time_limit      : maximum execution time in seconds (optional), default is 300s" << endl;
+    cout << "  -t nb_threads   : number of threads (optional), default is the number of cores" << endl;
+    cout << "                    (used by the pricing at the root, then each thread processes its own nodes)" << endl;
+    cout << "  -v              : add to enable verbose output (optional)" << endl;
+}
+
+int main(int argc, char** argv) {
+    int time_limit = 300;
+    bool verbose = false;
+    int nb_threads = max(1, (int)thread::hardware_concurrency());
+
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    // First argument : File path
+    string file_name = argv[1];
+    // Optionnal arguments
+    bool has_time_limit = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-v") {
+            verbose = true;
+        } else if (arg == "-t" && i + 1 < argc) {
+            try {
+                nb_threads = stoi(argv[++i]);
+            } catch (...) {
+                nb_threads = 0;
+            }
+            if (nb_threads <= 0) {
+                cerr << "Error: nb_threads must be a positive integer" << endl;
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!has_time_limit) {
+            try {
+                time_limit = stod(arg);
+                has_time_limit = true;
+                if (time_limit <= 0) {
+                    cerr << "Error: time_limit must be positive" << endl;
+                    usage(argv[0]);
+                    return 1;
+                }
+            } catch (...) {
+                cerr << "Error: Unknown argument" << endl;
+                usage(argv[0]);
+                return 1;
+            }
+        } else {
+            cerr << "Error: Unknown argument" << endl;
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Instance inst;
+    if (!inst.loadFromFile(file_name)) {
+        cerr << "Please enter valid file path" << endl;
+        return 1;
+    }
+    if (!inst.isFeasible()) {
+        cout << "Instance " << file_name << " is infeasible" << endl;
+        return 0;
+    }
+
+    cout << "Solving model using branch and price..." << endl;
+    ColGenModel model(inst, PricingMethod::DP, ColumnStrategy::MULTI, Stabilization::INOUT, verbose, nb_threads);
+    BranchAndPrice bp(model, nb_threads);
+    bp.solve(time_limit);
+    bp.printResult();
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
 
 #include "ColGenModel.hpp"
 #include "DivingHeuristic.hpp"
@@ -9,12 +10,18 @@
 using namespace std;
 
 void usage(const string& prog_name) {
-    cout << "Usage: " << prog_name << " file_path [time_limit] [pricing_method] [column_strategy] [stabilization] [-v]" << endl;
+    cout << "Usage: " << prog_name << " file_path [time_limit] [pricing_method] [column_strategy] [stabilization] [-k nb_cols] [-t nb_threads] [-gap value] [-tail k] [-partial quota] [-pb] [-v]" << endl;
     cout << "  file_path       : path to the input instance file" << endl;
     cout << "  time_limit      : maximum execution time in seconds (optional), default is 300s" << endl;
-    cout << "  pricing_method  : MIP or DP (optional), default is MULTI" << endl;
-    cout << "  column_strategy : SINGLE or MULTI (optional), default is MULTI" << endl;
-    cout << "  stabilization   : INOUT or NONE (optional), default is INOUT" << endl;
+    cout << "  pricing_method  : MIP, DP or HYBRID (optional), default is DP" << endl;
+    cout << "  column_strategy : SINGLE, MULTI or KBEST (optional), default is MULTI" << endl;
+    cout << "  stabilization   : INOUT, ADAPTIVE, BOXSTEP or NONE (optional), default is INOUT" << endl;
+    cout << "  -k nb_cols      : max number of columns per facility and per round with KBEST (optional), default is 3" << endl;
+    cout << "  -t nb_threads   : number of threads used to solve the pricing problems (optional), default is the number of cores" << endl;
+    cout << "  -gap value      : stop when the relative gap between the master and the lagrangian bound is below value (optional)" << endl;
+    cout << "  -tail k         : stop when the master improved by less than 0.01% during the last k iterations (optional)" << endl;
+    cout << "  -partial quota  : partial pricing, stop each round once quota columns were found (optional)" << endl;
+    cout << "  -pb             : add to solve the master with binary columns at the end (price and branch) to get an integer solution (optional)" << endl;
     cout << "  -v              : add to enable verbose output (optional)" << endl;
 }
 
@@ -25,6 +32,12 @@ int main(int argc, char** argv) {
     PricingMethod pricing_method = PricingMethod::DP;
     ColumnStrategy column_strategy = ColumnStrategy::MULTI;
     Stabilization stabilization = Stabilization::INOUT;
+    int nb_threads = max(1, (int)thread::hardware_concurrency());
+    bool price_and_branch = false;
+    double gap_tolerance = 0.0;
+    int tail_off_iterations = 0;
+    int partial_quota = 0;
+    int kbest_k = 3;
 
     if (argc < 2) {
         usage(argv[0]);
@@ -32,12 +45,6 @@ int main(int argc, char** argv) {
     }
     // First argument : File path
     string file_name = argv[1];
-    ifstream inst_file(file_name);
-    if (!inst_file) {
-        cerr << "Error: Couldn't open file!" << endl;
-        cerr << "Please enter valid file path" << endl;
-        return 1;
-    }
     // Optionnal arguments
     if (argc >= 3) {
         bool has_time_limit = false;
@@ -45,15 +52,80 @@ int main(int argc, char** argv) {
             string arg = argv[i];
             if (arg == "-v") {
                 verbose = true;
+            } else if (arg == "-pb") {
+                price_and_branch = true;
             } else if (arg == "SINGLE") {
                 column_strategy = ColumnStrategy::SINGLE;
+            } else if (arg == "KBEST") {
+                column_strategy = ColumnStrategy::KBEST;
             } else if (arg == "MIP") {
                 pricing_method = PricingMethod::MIP;
+            } else if (arg == "HYBRID") {
+                pricing_method = PricingMethod::HYBRID;
             } else if (arg == "NONE") {
                 stabilization = Stabilization::NONE;
+            } else if (arg == "ADAPTIVE") {
+                stabilization = Stabilization::ADAPTIVE;
+            } else if (arg == "BOXSTEP") {
+                stabilization = Stabilization::BOXSTEP;
+            } else if (arg == "-gap" && i + 1 < argc) {
+                try {
+                    gap_tolerance = stod(argv[++i]);
+                } catch (...) {
+                    gap_tolerance = -1;
+                }
+                if (gap_tolerance <= 0) {
+                    cerr << "Error: gap must be positive" << endl;
+                    usage(argv[0]);
+                    return 1;
+                }
+            } else if (arg == "-tail" && i + 1 < argc) {
+                try {
+                    tail_off_iterations = stoi(argv[++i]);
+                } catch (...) {
+                    tail_off_iterations = 0;
+                }
+                if (tail_off_iterations <= 0) {
+                    cerr << "Error: k must be a positive integer" << endl;
+                    usage(argv[0]);
+                    return 1;
+                }
+            } else if (arg == "-partial" && i + 1 < argc) {
+                try {
+                    partial_quota = stoi(argv[++i]);
+                } catch (...) {
+                    partial_quota = 0;
+                }
+                if (partial_quota <= 0) {
+                    cerr << "Error: quota must be a positive integer" << endl;
+                    usage(argv[0]);
+                    return 1;
+                }
+            } else if (arg == "-k" && i + 1 < argc) {
+                try {
+                    kbest_k = stoi(argv[++i]);
+                } catch (...) {
+                    kbest_k = 0;
+                }
+                if (kbest_k <= 0) {
+                    cerr << "Error: nb_cols must be a positive integer" << endl;
+                    usage(argv[0]);
+                    return 1;
+                }
+            } else if (arg == "-t" && i + 1 < argc) {
+                try {
+                    nb_threads = stoi(argv[++i]);
+                } catch (...) {
+                    nb_threads = 0;
+                }
+                if (nb_threads <= 0) {
+                    cerr << "Error: nb_threads must be a positive integer" << endl;
+                    usage(argv[0]);
+                    return 1;
+                }
             } else if (!has_time_limit) {
                 try {
-                    time_limit = stod(argv[2]);
+                    time_limit = stod(arg);
                     has_time_limit = true;
                     if (time_limit <= 0) {
                         cerr << "Error: time_limit must be positive" << endl;
@@ -74,16 +146,33 @@ int main(int argc, char** argv) {
     }
 
     Instance inst;
-    inst_file >> inst;
+    if (!inst.loadFromFile(file_name)) {
+        cerr << "Please enter valid file path" << endl;
+        return 1;
+    }
     if (!inst.isFeasible()) {
         cout << "Instance " << file_name << " is infeasible" << endl;
         return 0;
     }
 
     cout << "Solving model ..." << endl;
-    ColGenModel model(inst, pricing_method, column_strategy, stabilization, verbose);
+    ColGenModel model(inst, pricing_method, column_strategy, stabilization, verbose, nb_threads);
+    model.gap_tolerance = gap_tolerance;
+    model.tail_off_iterations = tail_off_iterations;
+    model.kbest_k = kbest_k;
+    model.partial_pricing = partial_quota > 0;
+    if (model.partial_pricing) {
+        model.partial_quota = partial_quota;
+    }
     model.solve(time_limit);
     model.printResult();
 
+    if (price_and_branch) {
+        cout << "Solving master with binary columns ..." << endl;
+        double LB = model.lowerBound();
+        double UB = model.priceAndBranch(time_limit);
+        cout << "Price and branch : UB = " << UB << ", LB = " << LB << " (gap " << 100 * (UB - LB) / UB << "%)" << endl;
+    }
+
     return 0;
 }
\ No newline at end of file
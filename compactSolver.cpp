@@ -27,12 +27,6 @@ int main(int argc, char** argv) {
 
     //  First argument : File path
     string file_name = argv[1];
-    ifstream inst_file(file_name);
-    if (!inst_file) {
-        cerr << "Error: Couldn't open file!" << endl;
-        cerr << "Please enter valid file path" << endl;
-        return 1;
-    }
     // Optionnal arguments
     if (argc >= 3) {
         bool has_time_limit = false;
@@ -65,7 +59,10 @@ int main(int argc, char** argv) {
     }
 
     Instance inst;
-    inst_file >> inst;
+    if (!inst.loadFromFile(file_name)) {
+        cerr << "Please enter valid file path" << endl;
+        return 1;
+    }
     if (!inst.isFeasible()) {
         cout << "Instance " << file_name << " is infeasible" << endl;
         return 0;
@@ -89,7 +86,7 @@ int main(int argc, char** argv) {
         auto dot = file_name.find_last_of('.');
         string instance_name = file_name.substr(slash + 1, dot - slash - 1);
         inst.visualize(sol, instance_name);
-        exportSolution(sol, instance_name);
+        exportSolution(inst, sol, instance_name);
         cout << "Successful!" << endl;
     }
 
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <string>
+
+#include "Instance.hpp"
+#include "Solution.hpp"
+using namespace std;
+
+void usage(const string& prog_name) {
+    cout << "Usage: " << prog_name << " input_file output_file [-nodist] [-float]" << endl;
+    cout << "  input_file  : instance (.inst or .binst) or solution (.sol or .bsol) to convert" << endl;
+    cout << "  output_file : converted file, the format is given by the extension:" << endl;
+    cout << "                .binst / .bsol for the binary format, anything else for the text format" << endl;
+    cout << "  -nodist     : don't store the distance matrix in the binary instance (optional)" << endl;
+    cout << "  -float      : store the distance matrix in single precision (optional)" << endl;
+}
+
+bool hasExtension(const string& file_name, const string& extension) {
+    return file_name.size() >= extension.size() && file_name.compare(file_name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    string input = argv[1];
+    string output = argv[2];
+    bool with_distances = true;
+    bool single_precision = false;
+    // Optionnal arguments
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-nodist") {
+            with_distances = false;
+        } else if (arg == "-float") {
+            single_precision = true;
+        } else {
+            cerr << "Error: Unknown argument" << endl;
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Solution files
+    if (hasExtension(input, ".sol") || hasExtension(input, ".bsol")) {
+        SolutionPositions sol;
+        if (!loadSolution(input, sol)) {
+            return 1;
+        }
+        if (!saveSolution(sol, output, hasExtension(output, ".bsol"))) {
+            cerr << "Error: couldn't write " << output << endl;
+            return 1;
+        }
+        cout << "Converted solution with " << sol.size() << " customers to " << output << endl;
+        return 0;
+    }
+
+    // Instance files
+    Instance inst;
+    if (!inst.loadFromFile(input, false)) {
+        return 1;
+    }
+    bool binary = hasExtension(output, ".binst");
+    if (binary && with_distances) {
+        inst.buildDistanceMatrix(single_precision);
+    }
+    if (!inst.saveToFile(output, binary, with_distances)) {
+        return 1;
+    }
+    cout << "Converted instance with " << inst.nb_customers << " customers and " << inst.nb_potential_facilities << " facilities to " << output
+         << endl;
+    return 0;
+}
@@ -1,17 +1,26 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
 
 #include "ColGenModel.hpp"
 #include "DivingHeuristic.hpp"
 #include "Heuristics.hpp"
 #include "Instance.hpp"
+#include "ParallelDiving.hpp"
 using namespace std;
 
 void usage(const string& prog_name) {
-    cout << "Usage: " << prog_name << " file_path [time_limit]" << endl;
+    cout << "Usage: " << prog_name << " file_path [time_limit] [diving_policy] [-th threshold] [-d nb_dives] [-t nb_threads] [-pb]" << endl;
     cout << "  file_path       : path to the input instance file" << endl;
     cout << "  time_limit      : maximum execution time in seconds (optional), default is 300s" << endl;
+    cout << "  diving_policy   : SINGLE or THRESHOLD (optional), default is SINGLE" << endl;
+    cout << "                    (THRESHOLD also fixes all the customer-facility pairs above the threshold at each step)" << endl;
+    cout << "  -th threshold   : threshold used by the THRESHOLD policy, between 0.5 and 1 (optional), default is 0.9" << endl;
+    cout << "  -d nb_dives     : number of dives run in parallel from the root relaxation (optional), default is 1" << endl;
+    cout << "                    (the first dive is the deterministic one, the others are randomized)" << endl;
+    cout << "  -t nb_threads   : number of threads used to solve the pricing problems (optional), default is the number of cores" << endl;
+    cout << "  -pb             : add to solve the master with binary columns after the dive (price and branch), starting from the dive solution (optional)" << endl;
 }
 
 int main(int argc, char** argv) {
@@ -21,6 +30,11 @@ int main(int argc, char** argv) {
     PricingMethod pricing_method = PricingMethod::DP;
     ColumnStrategy column_strategy = ColumnStrategy::MULTI;
     Stabilization stabilization = Stabilization::INOUT;
+    int nb_threads = max(1, (int)thread::hardware_concurrency());
+    DivingPolicy diving_policy = DivingPolicy::SINGLE;
+    double fix_threshold = 0.9;
+    int nb_dives = 1;
+    bool price_and_branch = false;
 
     if (argc < 2) {
         usage(argv[0]);
@@ -28,44 +42,103 @@ int main(int argc, char** argv) {
     }
     // First argument : File path
     string file_name = argv[1];
-    ifstream inst_file(file_name);
-    if (!inst_file) {
-        cerr << "Error: Couldn't open file!" << endl;
-        cerr << "Please enter valid file path" << endl;
-        return 1;
-    }
     // Optionnal arguments
-    if (argc == 3) {
-        bool has_time_limit = false;
-        try {
-            time_limit = stod(argv[2]);
-            has_time_limit = true;
-            if (time_limit <= 0) {
-                cerr << "Error: time_limit must be positive" << endl;
+    bool has_time_limit = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-pb") {
+            price_and_branch = true;
+        } else if (arg == "SINGLE") {
+            diving_policy = DivingPolicy::SINGLE;
+        } else if (arg == "THRESHOLD") {
+            diving_policy = DivingPolicy::THRESHOLD;
+        } else if (arg == "-th" && i + 1 < argc) {
+            try {
+                fix_threshold = stod(argv[++i]);
+            } catch (...) {
+                fix_threshold = 0.0;
+            }
+            if (fix_threshold <= 0.5 || fix_threshold >= 1.0) {
+                cerr << "Error: threshold must be between 0.5 and 1 (excluded)" << endl;
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-d" && i + 1 < argc) {
+            try {
+                nb_dives = stoi(argv[++i]);
+            } catch (...) {
+                nb_dives = 0;
+            }
+            if (nb_dives <= 0) {
+                cerr << "Error: nb_dives must be a positive integer" << endl;
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-t" && i + 1 < argc) {
+            try {
+                nb_threads = stoi(argv[++i]);
+            } catch (...) {
+                nb_threads = 0;
+            }
+            if (nb_threads <= 0) {
+                cerr << "Error: nb_threads must be a positive integer" << endl;
                 usage(argv[0]);
                 return 1;
             }
-        } catch (...) {
+        } else if (!has_time_limit) {
+            try {
+                time_limit = stod(arg);
+                has_time_limit = true;
+                if (time_limit <= 0) {
+                    cerr << "Error: time_limit must be positive" << endl;
+                    usage(argv[0]);
+                    return 1;
+                }
+            } catch (...) {
+                cerr << "Error: Unknown argument" << endl;
+                usage(argv[0]);
+                return 1;
+            }
+        } else {
             cerr << "Error: Unknown argument" << endl;
             usage(argv[0]);
             return 1;
         }
-    } else if (argc > 3) {
-        usage(argv[0]);
-        return 1;
     }
 
     Instance inst;
-    inst_file >> inst;
+    if (!inst.loadFromFile(file_name)) {
+        cerr << "Please enter valid file path" << endl;
+        return 1;
+    }
     if (!inst.isFeasible()) {
         cout << "Instance " << file_name << " is infeasible" << endl;
         return 0;
     }
 
     cout << "Solving model using diving heuristic..." << endl;
-    ColGenModel model(inst, PricingMethod::DP, ColumnStrategy::MULTI, Stabilization::INOUT);
-    DivingHeuristic diving(model);
-    diving.solve(time_limit);
-    diving.printResult();
+    ColGenModel model(inst, pricing_method, column_strategy, stabilization, verbose, nb_threads);
+    Solution incumbent;
+    double LB;  // lower bound of the root relaxation (not the master if the column generation stopped early)
+    if (nb_dives > 1) {
+        ParallelDiving diving(model, nb_dives, diving_policy, fix_threshold);
+        diving.solve(time_limit);
+        diving.printResult();
+        incumbent = diving.incumbent;
+        LB = diving.root_LP;
+    } else {
+        DivingHeuristic diving(model, diving_policy, fix_threshold);
+        diving.solve(time_limit);
+        diving.printResult();
+        incumbent = diving.convertSolution();
+        LB = diving.root_LP;
+    }
+
+    if (price_and_branch) {
+        cout << "Solving master with binary columns ..." << endl;
+        bool has_incumbent = !incumbent.empty() && inst.checker(incumbent);
+        double UB = model.priceAndBranch(time_limit, has_incumbent ? &incumbent : nullptr);
+        cout << "Price and branch : UB = " << UB << ", LB = " << LB << " (gap " << 100 * (UB - LB) / UB << "%)" << endl;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef BINARYFORMAT_HPP
+#define BINARYFORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief this namespace describes the binary versions of the .inst and .sol files
+ *
+ * Instance file (.binst):
+ * - InstanceHeader (32 bytes)
+ * - customer x, customer y (doubles), customer demands (int32)
+ * - facility x, facility y (doubles), facility capacities (int32)
+ * - (optional) distance matrix, facility-major, in double or float
+ *
+ * Solution file (.bsol):
+ * - SolutionHeader (16 bytes)
+ * - x, y (doubles) of the facility assigned to each customer
+ *
+ * Every array starts on a multiple of 8 bytes. Numbers are stored in the byte order of the machine
+ */
+namespace BinaryFormat {
+
+// Demands and capacities are copied directly from/to the int vectors of Instance
+static_assert(sizeof(int) == sizeof(int32_t), "demands and capacities are stored as 32 bit integers");
+
+constexpr char INSTANCE_MAGIC[4] = {'F', 'L', 'P', 'I'};
+constexpr char SOLUTION_MAGIC[4] = {'F', 'L', 'P', 'S'};
+constexpr uint32_t VERSION = 1;
+
+// Instance flags
+constexpr uint32_t HAS_DISTANCES = 1;
+constexpr uint32_t FLOAT_DISTANCES = 2;
+
+struct InstanceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    int32_t nb_customers;
+    int32_t nb_potential_facilities;
+    int32_t nb_max_open_facilities;
+    int32_t max_cap_new_depots;
+    uint32_t reserved;
+};
+
+struct SolutionHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t nb_customers;
+    uint32_t reserved;
+};
+
+/**
+ * @brief Round a size up to the next multiple of 8 bytes
+ */
+inline std::size_t align8(std::size_t size) {
+    return (size + 7) & ~std::size_t(7);
+}
+
+/**
+ * @brief Checks if the given content starts with the given magic
+ */
+inline bool hasMagic(const char* data, std::size_t size, const char (&magic)[4]) {
+    return size >= 4 && std::memcmp(data, magic, 4) == 0;
+}
+}  // namespace BinaryFormat
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef BRANCHANDPRICE_HPP
+#define BRANCHANDPRICE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "ColGenModel.hpp"
+#include "Column.hpp"
+#include "Solution.hpp"
+
+/**
+ * @brief Branching on the assignment of a customer to a facility: forced in one child, forbidden in the other
+ */
+struct BranchingDecision {
+    int customer;
+    int facility;
+    bool forced;
+};
+
+/**
+ * @brief Node of the branch and price tree: all the decisions taken from the root, and the LP bound of its parent
+ */
+struct Node {
+    double bound;
+    int depth;
+    std::vector<BranchingDecision> decisions;
+};
+
+/**
+ * @brief Order of the node queue: best bound first (then deepest first to find solutions sooner)
+ */
+struct NodeCompare {
+    bool operator()(const Node& a, const Node& b) const;
+};
+
+/**
+ * @struct BranchAndPrice
+ * @brief Solves the problem to optimality using column generation at each node of a branch and bound tree
+ *
+ * Branching is done on the customer-facility pairs (x_fc = sum of the columns of f that contain c),
+ * the pricing of ColGenModel respects the forced and forbidden assignments of the node.
+ * Nodes are processed in parallel: each worker has its own copy of the master problem,
+ * and every column generated by a worker is shared with the others (all the nodes inherit all the columns,
+ * the ones that don't respect the restrictions of the node get an upper bound of 0).
+ */
+struct BranchAndPrice {
+    ColGenModel& root;  // root model, solved by column generation at the start
+    int nb_workers;
+    std::vector<ColGenModel*> models;  // one copy of the master per worker
+
+    // Best bound node queue, protected by tree_mutex
+    std::priority_queue<Node, std::vector<Node>, NodeCompare> nodes;
+    std::mutex tree_mutex;
+    std::condition_variable queue_changed;
+    int nb_active_workers = 0;
+    bool stop = false;
+    std::chrono::high_resolution_clock::time_point start;
+
+    // Columns generated by all the workers (worker w already has the first nb_shared_seen[w] ones)
+    std::vector<Column> shared_cols;
+    std::vector<int> nb_shared_seen;
+
+    // Sparse accumulators of the x[f][c] values, one per worker
+    std::vector<std::vector<double>> x_fc;
+    std::vector<std::vector<int>> touched_fc;
+
+    // Results
+    double incumbent_value;
+    Solution incumbent;
+    double root_LP = 0.0;  // lower bound of the root relaxation (lagrangian bound if the root didn't converge)
+    double lower_bound = 0.0;
+    int nb_nodes = 0;
+    int nb_pruned = 0;
+    int nb_invalid_leaves = 0;  // integer x[f][c] that the checker refused (optimality is then never claimed)
+    double runtime = 0.0;
+
+    /**
+     * @brief Constructor for the BranchAndPrice structure
+     */
+    BranchAndPrice(ColGenModel& root, int nb_workers);
+
+    /**
+     * @brief Solve the root, find a first solution with a dive, then explore the tree until it is empty or the time limit is reached
+     */
+    void solve(int time_limit);
+
+    /**
+     * @brief Take nodes from the queue and process them until the tree is explored (or the time limit is reached)
+     */
+    void workerLoop(int worker, double time_limit);
+
+    /**
+     * @brief Time elapsed since the start of solve (in seconds)
+     */
+    double elapsed() const;
+
+    /**
+     * @brief Solve the node by column generation on the copy of given worker
+     * @return false if the time limit was reached before the end of the column generation
+     */
+    bool processNode(int worker, const Node& node, const std::vector<Column>& inherited_cols, double time_left, std::vector<Node>& children,
+                     Solution& sol);
+
+    /**
+     * @brief Get the most fractional customer-facility pair of the current solution of the model
+     * @return {-1, -1} if all the x[f][c] are integer (the corresponding assignment is then put in sol)
+     */
+    std::pair<int, int> getBranchingPair(int worker, Solution& sol);
+
+    /**
+     * @brief Keep the solution if it is valid and better than the incumbent (tree_mutex has to be locked)
+     */
+    bool submitSolution(Instance& inst, const Solution& sol);
+
+    /**
+     * @brief print the result in the terminal
+     */
+    void printResult();
+
+    ~BranchAndPrice();
+};
+
+#endif
@@ -2,15 +2,24 @@
 #define COLGENMODEL_HPP
 #include <gurobi_c++.h>
 
+#include <string>
 #include <utility>
 
 #include "Column.hpp"
+#include "ColumnPool.hpp"
+#include "ColumnStore.hpp"
 #include "Instance.hpp"
+#include "PricingWorkspace.hpp"
+#include "ThreadPool.hpp"
 
 // Col Gen Parameters
-enum class PricingMethod { DP, MIP };
-enum class ColumnStrategy { SINGLE, MULTI };
-enum class Stabilization { NONE, INOUT };
+// HYBRID: greedy heuristic first, dynamic programming only for the facilities where it finds no column
+enum class PricingMethod { DP, MIP, HYBRID };
+// KBEST: up to kbest_k columns per facility, taken from the best end states of the dynamic programming (one per facility with MIP)
+enum class ColumnStrategy { SINGLE, MULTI, KBEST };
+// INOUT: fixed alpha, ADAPTIVE: alpha tuned with the subgradient at the separation point and after each mispricing
+// BOXSTEP: the duals are kept in a box around the center (slack variables in the master), the box moves when the bound improves
+enum class Stabilization { NONE, INOUT, ADAPTIVE, BOXSTEP };
 
 /**
  * @struct struct that contains methods to solve the problem
@@ -29,32 +38,226 @@ struct ColGenModel {
 
     // To keep in memory total elapsed time (multiple optimize())
     double runtime;
+    int nb_iterations = 0;  // number of pricing rounds done by solve()
+
+    // Partial pricing: facilities are priced by blocks (one facility per thread), most promising first (reduced cost of the last round,
+    // then rotating order), until partial_quota columns are found. The lagrangian bound is only valid when every facility was priced
+    bool partial_pricing = false;
+    int partial_quota = 10;
+    std::vector<double> last_facility_rc;  // reduced cost found for each facility the last time it was priced
+    int rotation_start = 0;                // first facility of the rotating order
+    bool pricing_exact = true;             // every facility was solved to optimality in the last round (lagrangian bound valid)
+    std::vector<char> facility_exact;      // the sub problem of each facility was solved to optimality in the last round
+    int nb_partial_rounds = 0;             // rounds stopped before the last facility
+    bool force_exact = false;              // the next round prices every facility exactly (no partial stop, no heuristic)
+
+    // KBEST column strategy: the DP also keeps the next best end states of each facility (distinct loads so distinct columns)
+    int kbest_k = 3;                                // max number of columns per facility and per round
+    std::vector<std::vector<Column>> kbest_cols;    // columns found besides the best one, indexed by facility (last round)
+
+    // MIP pricing: one model per thread of the pool (with its own gurobi environment, an environment can't be shared by threads),
+    // created the first time the thread prices a facility. The facilities only differ by the capacity, so at each call only the
+    // capacity, the objective, the bounds and the start are updated. Each environment is a license checkout, so there are
+    // only nb_threads of them per model (clones made with clone(1) have one, and none if the MIP pricing isn't used)
+    std::vector<GRBEnv*> pricing_envs;
+    std::vector<GRBModel*> pricing_models;
+    std::vector<std::vector<GRBVar>> pricing_vars;     // z[c] = 1 if customer c is in the column
+    std::vector<GRBConstr> pricing_capacities;         // capacity constraint of each pricing model
+    std::vector<std::vector<double>> pricing_starts;   // last solution found for each facility (warm start)
+
+    // Threads used to solve the pricing sub problems of the different facilities in parallel
+    ThreadPool* pool;
+    std::vector<PricingWorkspace> workspaces;  // one per thread of the pool (sized for the biggest facility)
 
     // Variables
     std::vector<GRBVar> lambda;
-    std::vector<Column> model_cols;  // used for diving
+    ColumnStore model_cols;   // used for diving (column i of the store is the variable lambda[i])
+    bool name_vars = false;   // give a descriptive name to each column variable (only useful to debug, slow)
+    ColumnPool column_pool;   // every column added to the master (to reject duplicates), entry i is column i of the store
+
+    // Column management: columns that stay nonbasic with a big reduced cost for too long are removed from the master
+    // and kept in an inactive pool (they are added back if their reduced cost becomes negative)
+    bool purge_columns = true;
+    int purge_max_age = 20;              // nb of iterations a column can stay useless before being removed
+    int purge_frequency = 10;            // nb of iterations between two purges
+    double purge_rc_threshold = 1e-3;    // reduced cost above which a column is considered useless
+    std::vector<int> col_age;            // nb of consecutive iterations each column stayed useless
+    std::vector<Column> inactive_cols;   // columns removed from the master
+    int nb_purged = 0;
+    int nb_reactivated = 0;
+
+    // Restrictions on the assignments (diving and branching), respected by the pricing
+    std::vector<int> forced_facility_for_client;  // -1 if the customer is free
+    std::vector<char> forbidden_fc;               // forbidden_fc[f * nb_customers + c] = 1 if c can't be assigned to f
+    std::vector<int> nb_forced_at_facility;       // number of customers forced to each facility
+
+    // Artificial variables (one per customer constraint) so the master stays feasible whatever the restrictions
+    std::vector<GRBVar> artificials;
 
     // Constraints
     GRBConstr theta_constr;
     std::vector<GRBConstr> pi_constrs;
+    // At most one column per facility (only added by the branch and price, empty otherwise): in the LP two columns of the same
+    // facility can be used together, so an integer x[f][c] could exceed the capacity. The dual mu_f is added to theta in the pricing of f
+    std::vector<GRBConstr> facility_constrs;
+
+    // Duals of the customer constraints, fetched with a single gurobi call after each optimize (buffers are reused)
+    std::vector<double> current_pi;
+    std::vector<double> separation_pi;
+    std::vector<double> current_mu;  // duals of the facility constraints (0 without them)
+    bool duals_up_to_date = false;
 
     // For stabilization
     double theta_center;
     std::vector<double> pi_center;
     double stab_alpha = 0.5;
     double best_LB;  // Lagrangian bound
+    int nb_mispricings = 0;       // consecutive mispricings (ADAPTIVE)
+    double mispricing_alpha;      // base alpha during these mispricings, restored once a column is found (ADAPTIVE)
+    std::vector<GRBVar> box_plus;   // slack variables of the box (BOXSTEP): their costs bound the duals to
+    std::vector<GRBVar> box_minus;  // [pi_center - box_width, pi_center + box_width]
+    double box_width = 0.0;
+    double box_width_ratio = 0.1;   // initial width of the box, relative to the average dual
+    int nb_recenterings = 0;
+
+    // Stopping rules (besides the time limit and the end of the column generation)
+    double gap_tolerance = 0.0;     // stop when (master - lagrangian bound) <= gap_tolerance * master (0 = disabled)
+    int tail_off_iterations = 0;    // stop when the master improved by less than tail_off_epsilon (relative)
+    double tail_off_epsilon = 1e-4; // during the last tail_off_iterations reoptimizations (0 = disabled)
+    std::string stop_reason;        // only for printing
+    bool converged = false;         // the last solve stopped because no column had a negative reduced cost (the master is the LP)
+
+    // Bound trace: time, value of the master and lagrangian bound after each pricing of the last solve
+    std::vector<double> trace_time;
+    std::vector<double> trace_obj;
+    std::vector<double> trace_LB;
 
     /**
      * @brief Instanciate Relaxed Master Problem: create constraints and create initial cols to make a feasible solution
      * default pricing method and column strategy are set to the best (found after testing): DP an dMULTI and INOOUT stabilization
+     * nb_threads is the number of threads used to solve the pricing sub problems
      */
     ColGenModel(const Instance& inst_, PricingMethod pricing_method = PricingMethod::DP, ColumnStrategy column_strategy = ColumnStrategy::MULTI,
-                Stabilization stabilization = Stabilization::INOUT, bool verbose_ = false);
+                Stabilization stabilization = Stabilization::INOUT, bool verbose_ = false, int nb_threads = 1);
+
+    /**
+     * @brief Create an independent copy of the model (own gurobi environment and threads) with the same columns and stabilization state
+     * The copy is optimized so its duals are available right away (the caller has to delete it)
+     */
+    ColGenModel* clone(int nb_threads = 1) const;
 
     /**
      * @brief Take a column and add it the RMP, also update the column storage vector
+     * @return false if the column was already in the RMP (nothing is added)
+     */
+    bool addColumn(const Column& col);
+
+    /**
+     * @brief Add all the given columns to the RMP with a single gurobi call, also update the column storage vector
+     * Columns that are already in the RMP are skipped
+     * @return the number of columns actually added
+     */
+    int addColumns(const std::vector<Column>& cols);
+
+    /**
+     * @brief Update the age of each column (using the reduced costs of the current solution)
+     */
+    void updateColumnAges();
+
+    /**
+     * @brief Remove the columns that stayed useless for too long from the master, and put them in the inactive pool
+     * @return the number of columns removed
+     */
+    int purgeColumns();
+
+    /**
+     * @brief Add back the inactive columns that have a negative reduced cost with the current duals (no pricing needed)
+     * @return the number of columns reactivated
+     */
+    int reactivateColumns();
+
+    /**
+     * @brief Force the customer to be assigned to the facility (the columns aren't changed)
+     */
+    void forceAssignment(int customer, int facility);
+
+    /**
+     * @brief Forbid the assignment of the customer to the facility (the columns aren't changed)
+     */
+    void forbidAssignment(int customer, int facility);
+
+    /**
+     * @brief Checks if the i-th column respects the current restrictions
+     * (a column of a facility has to contain all the customers forced to it, and no customer forced elsewhere or forbidden)
+     */
+    bool isValidColumn(int i) const;
+
+    /**
+     * @brief Checks if a column with given facility and customers respects the current restrictions
+     */
+    bool respectsRestrictions(int facility, std::span<const int> customers) const;
+
+    /**
+     * @brief Set the upper bound of every column according to the current restrictions (1 if valid, 0 otherwise) with one gurobi call
+     */
+    void applyRestrictions();
+
+    /**
+     * @brief Remove all the restrictions (the bounds of the columns aren't changed, call applyRestrictions for that)
+     */
+    void clearRestrictions();
+
+    /**
+     * @brief Add an artificial variable with given cost to each customer constraint (only once)
+     */
+    void addArtificialVariables(double cost);
+
+    /**
+     * @brief Checks if an artificial variable is used in the current solution (the restricted problem is then infeasible)
+     */
+    bool usesArtificialVariables();
+
+    /**
+     * @brief Add the constraints "at most one column per facility" to the master (only once)
+     */
+    void addFacilityConstraints();
+
+    /**
+     * @brief Use the current duals as stabilization center and forget the lagrangian bound (needed when the restrictions change)
+     */
+    void resetStabilization();
+
+    /**
+     * @brief Lagrangian bound given by the duals and the results of the sub problems (each one has to be solved to optimality)
+     * The duals of the facility constraints are the ones of the last call to getMu (the sub problems were solved with them)
+     */
+    double lagrangianBound(double theta, const std::vector<double>& pi, const std::vector<std::pair<double, Column>>& sub_pbs) const;
+
+    /**
+     * @brief ADAPTIVE stabilization: update alpha with the direction of the subgradient at the separation point
+     * (alpha decreases if it goes towards the out point, increases otherwise), during a mispricing sequence the base alpha is updated
+     */
+    void adaptAlpha(double theta_out, const std::vector<double>& pi_out, const std::vector<std::pair<double, Column>>& sub_pbs);
+
+    /**
+     * @brief BOXSTEP stabilization: add the slack variables of the box around the current duals
+     */
+    void addBox();
+
+    /**
+     * @brief BOXSTEP stabilization: set the costs of the slack variables from pi_center and box_width
+     */
+    void updateBox();
+
+    /**
+     * @brief BOXSTEP stabilization: remove the slack variables of the box
+     */
+    void removeBox();
+
+    /**
+     * @brief BOXSTEP stabilization: checks if a slack variable of the box is used (the duals are stuck on the box)
      */
-    void addColumn(Column col);
+    bool boxIsActive();
 
     /**
      * @brief Get the value of theta
@@ -62,9 +265,14 @@ struct ColGenModel {
     double getTheta();
 
     /**
-     * @brief Get the values of pi_c
+     * @brief Get the values of pi_c (all fetched at once the first time it is called after an optimize)
+     */
+    const std::vector<double>& getPi();
+
+    /**
+     * @brief Get the duals of the facility constraints (fetched with pi, all 0 if there are no facility constraints)
      */
-    std::vector<double> getPi();
+    const std::vector<double>& getMu();
 
     /**
      * @brief Get the value of the separation theta (using formula seen in class)
@@ -74,13 +282,18 @@ struct ColGenModel {
     /**
      * @brief Get the value of the separation pi (using formula seen in class)
      */
-    std::vector<double> getSeparationPi();
+    const std::vector<double>& getSeparationPi();
 
     /**
      * @brief Get the value of the objection function in the current state of the model
      */
     double obj();
 
+    /**
+     * @brief Lower bound of the LP after the last solve: the master if the column generation converged, the lagrangian bound otherwise
+     */
+    double lowerBound();
+
     /**
      * @brief Optimize the model
      */
@@ -90,22 +303,52 @@ struct ColGenModel {
      * @brief Get the reduced costs of each customer associated with given facility
      * and the dual vector pi to consider
      */
-    std::vector<double> reducedCosts(int facility, std::vector<double> pi);
+    std::vector<double> reducedCosts(int facility, const std::vector<double>& pi);
+
+    /**
+     * @brief Same as above but writes the reduced costs in the given buffer (no allocation)
+     */
+    void reducedCosts(int facility, const std::vector<double>& pi, std::vector<double>& reduced_costs);
 
     /**
      * @brief Solve the pricing sub problem associated with given facility and given dual values
-     * using a mip solver
+     * using a mip solver (the persistent model of the facility is updated with the new reduced costs and restrictions)
      * @return a pair containing the best reduced cost found and the best column found
+     */
+    std::pair<double, Column> pricingSubProblemMIP(int facility, double theta, const std::vector<double>& pi, int thread_id);
 
+    /**
+     * @brief Create the pricing model of given thread (binary variables and capacity constraint), the rest is set by the pricing
      */
-    std::pair<double, Column> pricingSubProblemMIP(int facility, double theta, std::vector<double> pi);
+    void createPricingModel(int thread_id);
 
     /**
      * @brief Solve the pricing sub problem associated with given facility and given dual values
-     * using a dynammic programming approach
+     * using a dynammic programming approach (all the buffers come from the given workspace)
+     * With the KBEST strategy, the other improving columns (kbest_k - 1 at most) are stored in kbest_cols[facility]
      * @return a pair containing the best reduced cost found and the best column found
      */
-    std::pair<double, Column> pricingSubProblemDP(int facility, double theta, std::vector<double> pi);
+    std::pair<double, Column> pricingSubProblemDP(int facility, double theta, const std::vector<double>& pi, PricingWorkspace& ws);
+
+    /**
+     * @brief Heuristic for the pricing sub problem of given facility: greedy knapsack on the reduced cost per unit of demand,
+     * then one pass of swaps between the customers left out and the ones in the column
+     * (no guarantee of optimality, so it can miss negative columns)
+     */
+    std::pair<double, Column> pricingSubProblemGreedy(int facility, double theta, const std::vector<double>& pi, PricingWorkspace& ws);
+
+    /**
+     * @brief Solve the pricing sub problem of given facility with the chosen method (thread_id gives the workspace)
+     * facility_exact is set if the result is optimal
+     */
+    std::pair<double, Column> solveSubProblem(int facility, double theta, const std::vector<double>& pi, int thread_id);
+
+    /**
+     * @brief Solve the pricing sub problem of every facility (in parallel when possible)
+     * With partial pricing, stop as soon as enough columns were found (the other facilities get an empty result, see pricing_exact)
+     * @return the result of each sub problem, indexed by facility (so the merge order doesn't depend on the threads)
+     */
+    std::vector<std::pair<double, Column>> solveSubProblems(double theta, const std::vector<double>& pi);
 
     /**
      * @brief Solve the current pricing problem
@@ -127,6 +370,14 @@ struct ColGenModel {
      */
     int solve(int time_limit);
 
+    /**
+     * @brief Price and branch: solve the master with binary columns (on a copy of the model) to get an integer solution
+     * The restrictions and the artificial variables are ignored, the incumbent (if given) is used as a starting solution
+     * (its columns are added to the master if needed)
+     * @return the value of the best integer solution found (+inf if none), the solution is put in sol if given
+     */
+    double priceAndBranch(int time_limit, const Solution* incumbent = nullptr, Solution* sol = nullptr);
+
     /**
      * @brief print the result in the terminal
      */
@@ -29,7 +29,7 @@ struct Column {
      * @brief Get the cost associated with the column
      * (sum of the distances of each customer to the facility)
      */
-    double cost(const Instance& inst);
+    double cost(const Instance& inst) const;
 
     /**
      * @brief Override the << operator
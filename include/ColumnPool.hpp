@@ -0,0 +1,62 @@
+#ifndef COLUMNPOOL_HPP
+#define COLUMNPOOL_HPP
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "Column.hpp"
+
+/**
+ * @struct ColumnPool
+ * @brief Keeps track of every (facility, set of customers) already added to the master problem so the same column is never added twice
+ *
+ * Columns are found with a hash of the facility and the sorted customers,
+ * then compared entirely (so two different columns with the same hash are never mixed up)
+ */
+struct ColumnPool {
+    std::unordered_multimap<uint64_t, int> entries_of_hash;  // hash -> index of the entry
+
+    // Flat storage of the entries: entry i is keys[entry_begin[i]] to keys[entry_begin[i + 1] - 1]
+    // (the facility followed by the sorted customers)
+    std::vector<int> keys;
+    std::vector<int> entry_begin = {0};
+
+    long nb_hits = 0;  // number of duplicates rejected
+
+    /**
+     * @brief Hash of a column (customers have to be sorted)
+     */
+    static uint64_t hash(int facility, std::span<const int> customers);
+
+    /**
+     * @brief Get the index of the column in the pool (order of insertion), -1 if it isn't in it (customers have to be sorted)
+     */
+    int find(int facility, std::span<const int> customers) const;
+
+    /**
+     * @brief Checks if the column is already in the pool (customers have to be sorted)
+     */
+    bool contains(const Column& col) const;
+    bool contains(int facility, std::span<const int> customers) const;
+
+    /**
+     * @brief Add the column to the pool if it isn't already in it
+     * @return false if the column was a duplicate (and counts it as a hit)
+     */
+    bool insert(const Column& col);
+    bool insert(int facility, std::span<const int> customers);  // customers have to be sorted
+
+    /**
+     * @brief Number of different columns in the pool
+     */
+    int size() const;
+
+    /**
+     * @brief Remove every column from the pool (the hit counter is kept)
+     */
+    void clear();
+};
+
+#endif
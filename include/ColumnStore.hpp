@@ -0,0 +1,83 @@
+#ifndef COLUMNSTORE_HPP
+#define COLUMNSTORE_HPP
+
+#include <span>
+#include <vector>
+
+#include "Column.hpp"
+
+/**
+ * @brief Lightweight view on a column of a ColumnStore (nothing is copied, only valid until the store is modified)
+ */
+struct ColumnView {
+    int facility;
+    std::span<const int> customers;
+    double cost;
+
+    /**
+     * @brief Copy the viewed column into a real Column
+     */
+    Column toColumn() const;
+};
+
+/**
+ * @struct ColumnStore
+ * @brief Flat (CSR) storage of the columns of the master problem
+ *
+ * Column i has the facility facilities[i], the cost costs[i]
+ * and the customers customers[offsets[i]] to customers[offsets[i + 1] - 1]
+ *
+ * The store also keeps an inverted index (the columns containing each customer and the columns of each facility),
+ * updated each time a column is added
+ */
+struct ColumnStore {
+    std::vector<int> customers;
+    std::vector<int> offsets = {0};
+    std::vector<int> facilities;
+    std::vector<double> costs;
+
+    std::vector<std::vector<int>> cols_of_customer;  // customer -> indices of the columns that contain it
+    std::vector<std::vector<int>> cols_of_facility;  // facility -> indices of its columns
+
+    /**
+     * @brief Number of columns in the store
+     */
+    int size() const;
+
+    /**
+     * @brief Add a column at the end of the store (its customers are stored sorted)
+     */
+    void add(const Column& col, double cost);
+
+    /**
+     * @brief Get a view on the i-th column
+     */
+    ColumnView operator[](int i) const;
+
+    /**
+     * @brief Get the customers of the i-th column
+     */
+    std::span<const int> customersOf(int i) const;
+
+    /**
+     * @brief Checks if the i-th column contains the customer
+     */
+    bool contains(int i, int customer) const;
+
+    /**
+     * @brief Remove the columns i such that keep[i] is false (the order of the remaining columns is kept, the index is rebuilt)
+     */
+    void compact(const std::vector<char>& keep);
+
+    /**
+     * @brief Remove every column
+     */
+    void clear();
+
+    /**
+     * @brief Add the i-th column to the inverted index
+     */
+    void indexColumn(int i);
+};
+
+#endif
@@ -1,11 +1,17 @@
 #ifndef DIVINGHEURISTIC_HPP
 #define DIVINGHEURISTIC_HPP
 
+#include <atomic>
+#include <random>
 #include <vector>
 
 #include "ColGenModel.hpp"
 #include "Column.hpp"
 
+// SINGLE: fix the best fractional pair at each step
+// THRESHOLD: fix the best fractional pair and all the pairs above the threshold at each step
+enum class DivingPolicy { SINGLE, THRESHOLD };
+
 /**
  * @struct Contains all the methods and attributes needed to calcule a valid integer solution for the problem
  * using a basic diving heuristic
@@ -13,30 +19,47 @@
 struct DivingHeuristic {
     ColGenModel& model;  // model address so we can modify it from here
 
-    std::vector<int> forced_facility_for_client;  // keep in memory which assignments are forced
+    DivingPolicy policy;
+    double fix_threshold;  // only used by the THRESHOLD policy, has to be > 0.5 so a customer can't be fixed twice in one step
+    int top_k = 1;         // the pair to fix is picked at random among the top_k best ones (1 = deterministic dive)
+    std::mt19937 rng;
+
+    std::vector<char> disabled_col;  // columns of the master whose upper bound was set to 0
+    // (the forced assignments are kept in the model so that its pricing respects them)
+
+    // Sparse accumulator for the fictional x[f][c] values: x_fc[f * nb_customers + c], only the touched entries are non zero
+    std::vector<double> x_fc;
+    std::vector<int> touched_fc;
 
     double runtime;
+    double root_LP = 0.0;     // lower bound of the relaxation before the dive (lagrangian bound if the root didn't converge)
+    int nb_fixing_steps = 0;  // number of steps (each one is followed by a reoptimization and a pricing loop)
+    int nb_fixes = 0;         // number of customer-facility pairs fixed
 
     /**
      * @brief Constructor for the DivingHeursitic structure
      */
-    DivingHeuristic(ColGenModel& model);
+    DivingHeuristic(ColGenModel& model, DivingPolicy policy = DivingPolicy::SINGLE, double fix_threshold = 0.9);
 
     /**
-     * @brief Return the best Facility-Customer pair:
+     * @brief Return the Facility-Customer pairs to fix in this step (empty if the solution is integer):
      *
      * get the fictional x_fc values for the current state of the model
-     * and return the fc pair with the highest NON INTEGER value
+     * the first pair is the one with the highest NON INTEGER value,
+     * then (THRESHOLD policy only) all the other non integer pairs with a value above the threshold
+     * (only the columns with a positive value are visited, so the cost depends on the support of the LP solution)
      */
-    std::pair<int, int> getBestFCPair();
+    std::vector<std::pair<int, int>> getFCPairsToFix();
 
     /**
      * @brief Modify the model to prohibid all the columns that place the given customer with a facility that isn't the given one
+     *
+     * Only the columns of the facility and the columns containing the customer are looked at (inverted index of the column store)
      */
     void prohibidCols(int customer, int facility);
 
     /**
-     * @brief Solve the pricing problem : similar to the one is ColGenModel but adapted for the diving heuristic
+     * @brief Solve the pricing problem : the sub problems of ColGenModel (that respect the forced assignments) without stabilization
      *
      * NOTE: Should have used the in out separation version but more it's more complicated and I started having bugs and I was running out of time!
      * So i used the simple pricing version
@@ -44,12 +67,6 @@ struct DivingHeuristic {
      */
     std::vector<Column> pricing();
 
-    /**
-     * @brief Solve the pricing sub problem for given facility: similar to the one is ColGenModel (dynamic programming) but adapted for the diving
-     * heuristic
-     */
-    std::pair<double, Column> pricingSubProblem(int facility, double theta, const std::vector<double>& pi);
-
     /**
      * @brief Convert the current model state to a valid (checks if solution is valid first)
      */
@@ -64,6 +81,13 @@ struct DivingHeuristic {
      */
     void solve(int time_limit);
 
+    /**
+     * @brief Dive from the current state of the model (already solved by column generation) until an integer solution is found
+     * If an incumbent value is given, the dive is stopped as soon as its LP value can't beat it
+     * @return false if the dive was stopped before reaching an integer solution
+     */
+    bool dive(const std::atomic<double>* incumbent = nullptr);
+
     /**
      * @brief print the result of current state in terminal
      */
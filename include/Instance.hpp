@@ -2,7 +2,9 @@
 #define INSTANCE_HPP
 #include <fstream>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "Point2D.hpp"
 #include "Solution.hpp"
@@ -21,13 +23,73 @@ struct Instance {
     std::vector<Point2D> facility_positions;
     std::vector<int> facility_capacities;
 
+    // Distances between each facility and each customer, computed once when the instance is loaded
+    // Stored facility-major (distance_matrix[f * nb_customers + c]) so a facility's row is contiguous
+    // Only one of the two vectors is filled: the float one is used if single precision is asked (halves the memory)
+    std::vector<double> distance_matrix;
+    std::vector<float> distance_matrix_f;
+
+    // Index of each facility position (rebuilt by every loader)
+    std::unordered_map<Point2D, int, Point2DHash> facility_index_of_position;
+
+    /**
+     * @brief Compute the distance matrix (in single precision if asked)
+     */
+    void buildDistanceMatrix(bool single_precision = false);
+
+    /**
+     * @brief Fill facility_index_of_position from facility_positions (a duplicated position keeps its first index)
+     */
+    void buildFacilityIndex();
+
+    /**
+     * @brief Checks if the distance matrix was already computed
+     */
+    bool hasDistanceMatrix() const {
+        return !distance_matrix.empty() || !distance_matrix_f.empty();
+    }
+
+    /**
+     * @brief Get the distance between given facility and given customer (read from the distance matrix)
+     */
+    double dist(int facility, int customer) const {
+        size_t i = (size_t)facility * nb_customers + customer;
+        return distance_matrix_f.empty() ? distance_matrix[i] : (double)distance_matrix_f[i];
+    }
+
+    /**
+     * @brief Load the instance from a .inst file or a binary instance file (detected automatically):
+     * the file is memory mapped and parsed directly (much faster than operator>>)
+     * The header counts are checked against the content of the file
+     * If build_distances is false, the distance matrix isn't computed (ex: if we only want to check feasibility)
+     * @return false (and prints the reason) if the file couldn't be read or isn't a valid instance
+     */
+    bool loadFromFile(const std::string& file_path, bool build_distances = true);
+
+    /**
+     * @brief Parse the content of a .inst file (used by loadFromFile)
+     */
+    bool parse(const char* begin, const char* end, bool build_distances = true);
+
+    /**
+     * @brief Read the content of a binary instance file (used by loadFromFile)
+     * The distance matrix is taken from the file if it contains one
+     */
+    bool parseBinary(const char* data, size_t size, bool build_distances = true);
+
+    /**
+     * @brief Write the instance in a file, either in the .inst format or in the binary format (see BinaryFormat.hpp)
+     * with_distances: add the distance matrix to the binary file (in the precision currently used)
+     */
+    bool saveToFile(const std::string& file_path, bool binary, bool with_distances = true);
+
     /**
      * @brief Checks if the instance is feasible
      */
     bool isFeasible();
 
     /**
-     * @brief Checks if the given solution is valid
+     * @brief Checks if the given solution is valid (in O(customers + facilities))
      */
     bool checker(const Solution& sol);
 
@@ -43,6 +105,17 @@ struct Instance {
      */
     int get_facility_index(const Point2D& pos);
 
+    /**
+     * @brief Convert a solution to the format of the .sol files (position of the facility of each customer)
+     */
+    SolutionPositions toPositions(const Solution& sol) const;
+
+    /**
+     * @brief Convert a solution read from a .sol file to facility indices
+     * (customers assigned to a position that isn't a facility get -1, so the checker refuses the solution)
+     */
+    Solution fromPositions(const SolutionPositions& positions);
+
     /**
      * @brief Create an SVG file to visualize an instance/solution
      */
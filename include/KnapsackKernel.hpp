@@ -0,0 +1,31 @@
+#ifndef KNAPSACKKERNEL_HPP
+#define KNAPSACKKERNEL_HPP
+
+#include <cstdint>
+
+/**
+ * @brief this namespace contains the inner loop of the knapsack dynamic programming used by the pricing
+ *
+ * The vectorized versions (AVX2 / AVX-512) are chosen at runtime depending on what the CPU supports,
+ * and give exactly the same RC row and decision bits as the scalar version
+ */
+namespace KnapsackKernel {
+
+/**
+ * @brief Try to add an item (customer) with given demand and reduced cost to every state, from capacity down to demand:
+ * if RC[state - demand] + c_rc < RC[state], RC[state] is updated and the bit of state is set in the choices row
+ */
+void addItem(double* RC, uint64_t* choices, int capacity, int demand, double c_rc);
+
+/**
+ * @brief Scalar version of addItem (used when the CPU has no AVX2)
+ */
+void addItemScalar(double* RC, uint64_t* choices, int capacity, int demand, double c_rc);
+
+/**
+ * @brief Name of the version used by addItem on this CPU ("avx512", "avx2" or "scalar")
+ */
+const char* implementationName();
+}  // namespace KnapsackKernel
+
+#endif
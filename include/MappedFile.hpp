@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @struct MappedFile
+ * @brief Read-only view of the whole content of a file (memory mapped when the system allows it)
+ * The content is released when the object is destroyed
+ */
+struct MappedFile {
+    const char* data = nullptr;
+    std::size_t size = 0;
+
+    // Only used when mmap isn't available: the content is read in this buffer
+    std::string buffer;
+    bool mapped = false;
+
+    /**
+     * @brief Open and map the file
+     * @return false (and prints the reason) if the file couldn't be read
+     */
+    bool open(const std::string& file_path);
+
+    /**
+     * @brief Release the content
+     */
+    void close();
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef PARALLELDIVING_HPP
+#define PARALLELDIVING_HPP
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "ColGenModel.hpp"
+#include "DivingHeuristic.hpp"
+#include "Solution.hpp"
+
+/**
+ * @struct ParallelDiving
+ * @brief Runs several dives in parallel from the same root relaxation and keeps the best integer solution found
+ *
+ * Each dive works on its own copy of the root master problem (columns and stabilization state).
+ * The first dive is the deterministic one, the other ones pick the pair to fix at random among the top_k best pairs.
+ * The value of the best solution is shared so that the dives that can't beat it anymore are stopped early.
+ */
+struct ParallelDiving {
+    ColGenModel& root;  // root model, solved by column generation before the dives
+
+    int nb_dives;
+    DivingPolicy policy;
+    double fix_threshold;
+    int top_k = 3;
+
+    std::atomic<double> incumbent_value;
+    Solution incumbent;
+    std::mutex incumbent_mutex;  // protects the incumbent solution
+
+    double root_LP = 0.0;  // lower bound of the root relaxation (lagrangian bound if the root didn't converge)
+    int nb_finished = 0;  // dives that reached an integer solution
+    int nb_aborted = 0;   // dives stopped because they couldn't beat the incumbent
+    double runtime = 0.0;
+
+    /**
+     * @brief Constructor for the ParallelDiving structure
+     */
+    ParallelDiving(ColGenModel& root, int nb_dives, DivingPolicy policy = DivingPolicy::SINGLE, double fix_threshold = 0.9);
+
+    /**
+     * @brief Solve the root relaxation, then run the dives using the threads of the root model
+     *
+     * NOTE: like in DivingHeuristic, the time limit is only used for the root solve
+     */
+    void solve(int time_limit);
+
+    /**
+     * @brief Keep the solution if it is valid and better than the incumbent
+     * @return true if the incumbent was updated
+     */
+    bool submitSolution(Instance& inst, const Solution& sol);
+
+    /**
+     * @brief print the result in the terminal
+     */
+    void printResult();
+};
+
+#endif
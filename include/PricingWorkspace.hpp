@@ -0,0 +1,66 @@
+#ifndef PRICINGWORKSPACE_HPP
+#define PRICINGWORKSPACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @struct PricingWorkspace
+ * @brief Buffers used by the pricing (dynamic programming and greedy), allocated once and reused at every call
+ * (each thread of the pricing gets its own workspace)
+ */
+struct PricingWorkspace {
+    std::vector<double> rc;  // reduced cost of each customer
+    std::vector<double> RC;  // best reduced cost found for each capacity state
+    // Backtrack table: bit (c, state) is set if customer c is in the best sol of the state when c was considered
+    // One row of nb_words 64-bit words per customer, all rows are contiguous
+    std::vector<uint64_t> choices;
+    int nb_words = 0;
+    // Used by the greedy pricing
+    std::vector<char> in_col;
+    std::vector<int> candidates;
+    // Customers kept by the trimming of the dynamic programming (one row of the backtrack table each)
+    std::vector<int> kept;
+
+    // Trimming statistics of the dynamic programming (summed over all the calls made with this workspace)
+    long nb_calls = 0;
+    long nb_customers_total = 0;
+    long nb_customers_kept = 0;
+    long nb_states_total = 0;
+    long nb_states_kept = 0;
+
+    /**
+     * @brief Allocate the buffers for the biggest sub problem that will be solved
+     */
+    void reserve(int nb_customers, int max_capacity);
+
+    /**
+     * @brief Prepare the buffers for a sub problem with given capacity:
+     * RC is set to +inf (except state 0) and the backtrack table is cleared
+     */
+    void reset(int nb_customers, int capacity);
+
+    /**
+     * @brief Get the row of the backtrack table associated with given customer
+     */
+    uint64_t* row(int customer) {
+        return choices.data() + (std::size_t)customer * nb_words;
+    }
+
+    /**
+     * @brief Mark customer as part of the best sol of given state
+     */
+    void set(int customer, int state) {
+        row(customer)[state >> 6] |= uint64_t(1) << (state & 63);
+    }
+
+    /**
+     * @brief Check if customer is part of the best sol of given state
+     */
+    bool get(int customer, int state) const {
+        return (choices[(std::size_t)customer * nb_words + (state >> 6)] >> (state & 63)) & 1;
+    }
+};
+
+#endif
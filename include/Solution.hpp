@@ -4,28 +4,49 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "Point2D.hpp"
 
+struct Instance;
+
 /**
- * @brief A solution is represented as a vector of facility positions
+ * @brief A solution is represented as a vector of facility indices
+ * (where each line represents the index of the opened facility associated with the customer)
+ */
+using Solution = std::vector<int>;
+
+/**
+ * @brief Format of the .sol files: a vector of facility positions
  * (where each line represents the coordinates of the opened facility associated with the customer)
+ * Only used to read/write files (see Instance::toPositions and Instance::fromPositions)
+ */
+using SolutionPositions = std::vector<Point2D>;
+
+/**
+ * @brief Export the solution in a .sol file (or a .bsol file if binary is true)
+ */
+void exportSolution(const Instance& inst, const Solution& sol, std::string sol_name, bool binary = false);
+
+/**
+ * @brief Write the solution in the given file, either in the .sol format or in the binary format (see BinaryFormat.hpp)
  */
-using Solution = std::vector<Point2D>;
+bool saveSolution(const SolutionPositions& sol, const std::string& file_path, bool binary);
 
 /**
- * @brief Export the solution in a .sol file
+ * @brief Read a solution from a .sol file or a binary solution file (detected automatically)
+ * @return false (and prints the reason) if the file couldn't be read
  */
-void exportSolution(Solution sol, std::string sol_name);
+bool loadSolution(const std::string& file_path, SolutionPositions& sol);
 
 /**
  * @brief Override the << operator
  */
-std::ostream& operator<<(std::ostream& out, const Solution& sol);
+std::ostream& operator<<(std::ostream& out, const SolutionPositions& sol);
 
 /**
  * @brief Override the >> operator
  */
-std::istream& operator>>(std::istream& in, Solution& sol);
+std::istream& operator>>(std::istream& in, SolutionPositions& sol);
 
 #endif
\ No newline at end of file
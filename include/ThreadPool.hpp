@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct ThreadPool
+ * @brief Persistent pool of worker threads used to solve independent tasks (ex: the pricing sub problems) in parallel
+ *
+ * The threads are created once and wait for work between two calls of parallelFor
+ * (so we don't pay the thread creation cost at every pricing iteration)
+ */
+struct ThreadPool {
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+
+    // Current batch of tasks
+    const std::function<void(int, int)>* task = nullptr;
+    int nb_tasks = 0;
+    std::atomic<int> next_task = 0;
+    int nb_running_workers = 0;
+    int generation = 0;  // incremented every time a new batch is submitted
+    bool stop = false;
+    std::exception_ptr error;
+
+    /**
+     * @brief Create a pool using nb_threads threads in total (the calling thread counts as one of them)
+     */
+    ThreadPool(int nb_threads);
+
+    /**
+     * @brief Get the total number of threads (workers + calling thread)
+     */
+    int size() const;
+
+    /**
+     * @brief Call task(i, thread_id) for each i in [0, n) using all the threads and wait until every call is done
+     * thread_id is in [0, size()) so it can be used to give each thread its own workspace
+     * If a task throws, the first exception is rethrown in the calling thread
+     */
+    void parallelFor(int n, const std::function<void(int, int)>& task);
+
+    /**
+     * @brief Take tasks from the current batch until there are none left
+     */
+    void runTasks(int thread_id);
+
+    /**
+     * @brief Main loop of each worker thread
+     */
+    void workerLoop(int thread_id);
+
+    ~ThreadPool();
+};
+
+#endif
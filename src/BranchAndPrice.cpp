@@ -0,0 +1,299 @@
+#include "BranchAndPrice.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "DivingHeuristic.hpp"
+using namespace std;
+
+bool NodeCompare::operator()(const Node& a, const Node& b) const {
+    // priority_queue puts the "biggest" element on top
+    if (a.bound != b.bound) {
+        return a.bound > b.bound;
+    }
+    return a.depth < b.depth;
+}
+
+BranchAndPrice::BranchAndPrice(ColGenModel& root, int nb_workers)
+    : root(root), nb_workers(nb_workers), incumbent_value(numeric_limits<double>::infinity()) {}
+
+double BranchAndPrice::elapsed() const {
+    chrono::duration<double> time_elapsed = chrono::high_resolution_clock::now() - start;
+    return time_elapsed.count();
+}
+
+bool BranchAndPrice::submitSolution(Instance& inst, const Solution& sol) {
+    if (!inst.checker(sol)) {
+        return false;
+    }
+    double value = inst.objective_value(sol);
+    if (value >= incumbent_value) {
+        return false;
+    }
+    incumbent = sol;
+    incumbent_value = value;
+    return true;
+}
+
+pair<int, int> BranchAndPrice::getBranchingPair(int worker, Solution& sol) {
+    ColGenModel& model = *models[worker];
+    int nb_c = model.inst.nb_customers;
+    vector<double>& x = x_fc[worker];
+    vector<int>& touched = touched_fc[worker];
+    x.resize(model.inst.nb_potential_facilities * nb_c, 0.0);  // always left at 0 after each call
+
+    // Reconstructing x[f][c] values (only the columns used by the solution)
+    double* vals = model.model->get(GRB_DoubleAttr_X, model.lambda.data(), model.lambda.size());
+    for (int i = 0; i < model.lambda.size(); i++) {
+        if (vals[i] > 1e-6) {
+            ColumnView col = model.model_cols[i];
+            for (int c : col.customers) {
+                int fc = col.facility * nb_c + c;
+                if (x[fc] == 0.0) {
+                    touched.push_back(fc);
+                }
+                x[fc] += vals[i];
+            }
+        }
+    }
+    delete[] vals;
+
+    // Get the most fractional pair (closest to 0.5), ties are broken by smallest facility then smallest customer
+    int best_fc = -1;
+    double best_distance = 1.0;
+    sol.assign(nb_c, -1);
+    for (int fc : touched) {
+        double val = x[fc];
+        if (val > 1e-4 && val < 1.0 - 1e-4) {  // allow for rounding erros
+            double distance = abs(val - 0.5);
+            if (distance < best_distance || (distance == best_distance && fc < best_fc)) {
+                best_distance = distance;
+                best_fc = fc;
+            }
+        } else if (val >= 1.0 - 1e-4) {
+            sol[fc % nb_c] = fc / nb_c;
+        }
+        x[fc] = 0.0;
+    }
+    touched.clear();
+    if (best_fc == -1) {
+        return {-1, -1};
+    }
+    return {best_fc / nb_c, best_fc % nb_c};
+}
+
+bool BranchAndPrice::processNode(int worker, const Node& node, const vector<Column>& inherited_cols, double time_left, vector<Node>& children,
+                                 Solution& sol) {
+    ColGenModel& model = *models[worker];
+    model.addColumns(inherited_cols);
+
+    // Restrictions of the node
+    model.clearRestrictions();
+    for (const BranchingDecision& decision : node.decisions) {
+        if (decision.forced) {
+            model.forceAssignment(decision.customer, decision.facility);
+        } else {
+            model.forbidAssignment(decision.customer, decision.facility);
+        }
+    }
+    model.applyRestrictions();
+    model.optimize();
+    model.resetStabilization();  // the center of the previous node isn't relevant anymore
+
+    // Column generation
+    int nb_cols_before = model.model_cols.size();
+    double solve_start = elapsed();
+    model.solve(max(1, (int)ceil(time_left)));
+    bool finished = elapsed() - solve_start < time_left;
+    {
+        lock_guard<std::mutex> lock(tree_mutex);
+        for (int i = nb_cols_before; i < model.model_cols.size(); i++) {
+            shared_cols.push_back(model.model_cols[i].toColumn());
+        }
+    }
+    if (!finished) {
+        return false;
+    }
+
+    // The node is infeasible if the artificial variables are still needed
+    if (model.model->get(GRB_IntAttr_Status) != GRB_OPTIMAL || model.usesArtificialVariables()) {
+        return true;
+    }
+    double bound = model.lowerBound();
+    {
+        lock_guard<std::mutex> lock(tree_mutex);
+        if (bound >= incumbent_value - 1e-6) {  // can't be better than the incumbent
+            return true;
+        }
+    }
+    pair<int, int> fc = getBranchingPair(worker, sol);
+    if (fc.first == -1) {  // integer solution, sol is filled
+        return true;
+    }
+    sol.clear();
+    for (bool forced : {true, false}) {
+        Node child{bound, node.depth + 1, node.decisions};
+        child.decisions.push_back({fc.second, fc.first, forced});
+        children.push_back(std::move(child));
+    }
+    return true;
+}
+
+void BranchAndPrice::workerLoop(int worker, double time_limit) {
+    while (true) {
+        Node node;
+        vector<Column> inherited_cols;
+        {
+            unique_lock<std::mutex> lock(tree_mutex);
+            queue_changed.wait(lock, [&]() { return stop || !nodes.empty() || nb_active_workers == 0; });
+            if (stop) {
+                return;
+            }
+            if (nodes.empty()) {  // nobody is working and nothing left to do: tree explored
+                stop = true;
+                queue_changed.notify_all();
+                return;
+            }
+            if (nodes.top().bound >= incumbent_value - 1e-6) {
+                // Best bound first: all the remaining nodes can be pruned
+                nb_pruned += nodes.size();
+                nodes = {};
+                continue;
+            }
+            if (elapsed() >= time_limit) {
+                stop = true;
+                queue_changed.notify_all();
+                return;
+            }
+            node = nodes.top();
+            nodes.pop();
+            nb_nodes++;
+            nb_active_workers++;
+            inherited_cols.assign(shared_cols.begin() + nb_shared_seen[worker], shared_cols.end());
+            nb_shared_seen[worker] = shared_cols.size();
+        }
+
+        vector<Node> children;
+        Solution sol;
+        bool finished = false;
+        try {
+            finished = processNode(worker, node, inherited_cols, time_limit - elapsed(), children, sol);
+        } catch (...) {
+            // Don't leave the other workers waiting
+            lock_guard<std::mutex> lock(tree_mutex);
+            stop = true;
+            nb_active_workers--;
+            queue_changed.notify_all();
+            throw;
+        }
+
+        lock_guard<std::mutex> lock(tree_mutex);
+        // (the columns shared by this worker will come back to it with the next node, the pool of its copy rejects them)
+        if (!finished) {
+            nodes.push(node);  // time limit reached: the node stays open
+        }
+        if (!sol.empty()) {
+            if (models[worker]->inst.checker(sol)) {
+                submitSolution(models[worker]->inst, sol);
+            } else {
+                nb_invalid_leaves++;
+            }
+        }
+        for (Node& child : children) {
+            nodes.push(std::move(child));
+        }
+        nb_active_workers--;
+        queue_changed.notify_all();
+    }
+}
+
+void BranchAndPrice::solve(int time_limit) {
+    start = chrono::high_resolution_clock::now();
+
+    // Root node
+    root.solve(time_limit);
+    root_LP = root.lowerBound();  // the master is only a lower bound if the column generation converged
+
+    // First upper bound with a dive on a copy of the root
+    ColGenModel* diving_model = root.clone(root.pool->size());
+    DivingHeuristic diving(*diving_model);
+    if (diving.dive()) {
+        submitSolution(diving_model->inst, diving.convertSolution());
+    }
+    for (int i = 0; i < diving_model->model_cols.size(); i++) {
+        shared_cols.push_back(diving_model->model_cols[i].toColumn());
+    }
+    delete diving_model;
+
+    // Copies of the master for the workers: artificial variables are more expensive than any solution,
+    // the restricted masters then stay feasible
+    double big_M = 1.0;
+    for (int c = 0; c < root.inst.nb_customers; c++) {
+        double max_dist = 0.0;
+        for (int f = 0; f < root.inst.nb_potential_facilities; f++) {
+            max_dist = max(max_dist, root.inst.dist(f, c));
+        }
+        big_M += max_dist;
+    }
+    nb_workers = max(1, min(nb_workers, root.pool->size()));
+    models.resize(nb_workers);
+    for (int w = 0; w < nb_workers; w++) {
+        models[w] = root.clone(1);
+        models[w]->purge_columns = false;  // inactive columns would have to be checked against the restrictions of each node
+        models[w]->model->set(GRB_IntParam_Threads, 1);
+        models[w]->addArtificialVariables(big_M);
+        // Without it, two columns of a facility can be used together with an integer x[f][c] and exceed the capacity
+        models[w]->addFacilityConstraints();
+    }
+    nb_shared_seen.assign(nb_workers, 0);
+    x_fc.assign(nb_workers, {});
+    touched_fc.assign(nb_workers, {});
+
+    // The root node is solved again by a worker (with the same checks as the other nodes, the columns of the root are kept)
+    nodes.push(Node{root_LP, 0, {}});
+    root.pool->parallelFor(nb_workers, [&](int w, int thread_id) { workerLoop(w, time_limit); });
+
+    // The lower bound is the best bound of the open nodes (or the incumbent if the tree was fully explored)
+    lower_bound = incumbent_value;
+    if (!nodes.empty()) {
+        lower_bound = min(lower_bound, nodes.top().bound);
+    }
+    runtime = elapsed();
+}
+
+void BranchAndPrice::printResult() {
+    if (incumbent.empty()) {
+        cout << "---------------------------" << endl;
+        cerr << "NO FEASIBLE INTEGER SOLUTION FOUND!" << endl;
+        cout << "---------------------------" << endl;
+    } else if (lower_bound >= incumbent_value - 1e-6 && nb_invalid_leaves == 0) {
+        cout << "-----------------------" << endl;
+        cout << "OPTIMAL INTEGER SOLUTION FOUND!" << endl;
+        cout << "-----------------------" << endl;
+        cout << "Optimal solution value : " << incumbent_value << " (" << fixed << setprecision(4) << runtime << "s)" << endl;
+    } else {
+        cout << "--------------------------------------------" << endl;
+        cout << "NO OPTIMAL SOLUTION FOUND WITHIN TIME LIMIT!" << endl;
+        cout << "--------------------------------------------" << endl;
+        cout << "Best solution value : " << incumbent_value << " (" << fixed << setprecision(4) << runtime << "s)" << endl;
+        cout << "Lower bound : " << lower_bound << " (gap " << 100 * (incumbent_value - lower_bound) / incumbent_value << "%)" << endl;
+    }
+    if (root_LP > -numeric_limits<double>::infinity()) {
+        cout << "Root relaxation : " << root_LP << endl;
+    } else {
+        cout << "Root relaxation : no valid bound (the column generation didn't converge)" << endl;
+    }
+    cout << "Nodes : " << nb_nodes << " processed, " << nb_pruned << " pruned, " << nodes.size() << " open" << endl;
+    if (nb_invalid_leaves > 0) {
+        cout << "WARNING: " << nb_invalid_leaves << " integer leaves were refused by the checker (the tree wasn't fully explored)" << endl;
+    }
+}
+
+BranchAndPrice::~BranchAndPrice() {
+    for (ColGenModel* model : models) {
+        delete model;
+    }
+}
@@ -1,27 +1,46 @@
 #include "ColGenModel.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <numeric>
 #include <string>
 
 #include "Heuristics.hpp"
 #include "Instance.hpp"
+#include "KnapsackKernel.hpp"
 #include "Solution.hpp"
 #include "gurobi_c++.h"
 using namespace std;
 
 ColGenModel::ColGenModel(const Instance& inst_, PricingMethod pricing_method_, ColumnStrategy column_strategy_, Stabilization stabilization_,
-                         bool verbose_)
+                         bool verbose_, int nb_threads)
     : inst(inst_), pricing_method(pricing_method_), column_strategy(column_strategy_), stabilization(stabilization_), verbose(verbose_) {
+    pool = new ThreadPool(max(1, nb_threads));
+    // Size the pricing buffers once for the biggest facility
+    int max_capacity = *max_element(inst.facility_capacities.begin(), inst.facility_capacities.end());
+    workspaces.resize(pool->size());
+    for (PricingWorkspace& ws : workspaces) {
+        ws.reserve(inst.nb_customers, max_capacity);
+    }
+    if (!inst.hasDistanceMatrix()) {
+        inst.buildDistanceMatrix();
+    }
     env = new GRBEnv(true);
     if (!verbose) {
         env->set(GRB_IntParam_LogToConsole, 0);
     }
     env->start();
     model = new GRBModel(*env);
+    // The MIP pricing models are only created when needed
+    pricing_envs.assign(pool->size(), nullptr);
+    pricing_models.assign(pool->size(), nullptr);
+    pricing_vars.resize(pool->size());
+    pricing_capacities.resize(pool->size());
+    pricing_starts.resize(inst.nb_potential_facilities);
 
     // CONSTRAINTS
     // Each customer is assigned to one facility
@@ -32,30 +51,278 @@ ColGenModel::ColGenModel(const Instance& inst_, PricingMethod pricing_method_, C
     // Don't use more than p columns
     theta_constr = model->addConstr(0, GRB_LESS_EQUAL, inst.nb_max_open_facilities, "no more than p columns");
 
+    // No restriction at first
+    forced_facility_for_client.assign(inst.nb_customers, -1);
+    forbidden_fc.assign(inst.nb_potential_facilities * inst.nb_customers, 0);
+    nb_forced_at_facility.assign(inst.nb_potential_facilities, 0);
+    current_mu.assign(inst.nb_potential_facilities, 0.0);
+
     // Create an initial valid solution
-    vector<Column> cols = Heuristics::pBiggestFacilities(inst);
-    for (Column col : cols) {
-        addColumn(col);
-    }
+    addColumns(Heuristics::pBiggestFacilities(inst));
     optimize();
 
     // Initialize stabilization
-    theta_center = getTheta();
-    pi_center = getPi();
-    best_LB = -numeric_limits<double>::infinity();
+    resetStabilization();
+}
+
+ColGenModel* ColGenModel::clone(int nb_threads) const {
+    ColGenModel* copy = new ColGenModel(inst, pricing_method, column_strategy, stabilization, false, nb_threads);
+    // Pricing and column management parameters (before the columns are added, for name_vars)
+    copy->partial_pricing = partial_pricing;
+    copy->partial_quota = partial_quota;
+    copy->kbest_k = kbest_k;
+    copy->name_vars = name_vars;
+    copy->purge_columns = purge_columns;
+    copy->purge_max_age = purge_max_age;
+    copy->purge_frequency = purge_frequency;
+    copy->purge_rc_threshold = purge_rc_threshold;
+    copy->box_width_ratio = box_width_ratio;
+
+    vector<Column> cols;
+    cols.reserve(model_cols.size());
+    for (int i = 0; i < model_cols.size(); i++) {
+        cols.push_back(model_cols[i].toColumn());
+    }
+    copy->addColumns(cols);  // the initial columns are rejected by the pool if they are already there
+    if (!facility_constrs.empty()) {
+        copy->addFacilityConstraints();
+    }
+    copy->inactive_cols = inactive_cols;
+    copy->optimize();
+    copy->theta_center = theta_center;
+    copy->pi_center = pi_center;
+    copy->stab_alpha = stab_alpha;
+    copy->best_LB = best_LB;
+    return copy;
+}
+
+bool ColGenModel::addColumn(const Column& col) {
+    return addColumns({col}) == 1;
+}
+
+int ColGenModel::addColumns(const vector<Column>& all_cols) {
+    // Remove the columns that are already in the master
+    vector<const Column*> cols;
+    for (const Column& col : all_cols) {
+        if (column_pool.insert(col)) {
+            cols.push_back(&col);
+        }
+    }
+    int nb_new_cols = cols.size();
+    if (nb_new_cols == 0) {
+        return 0;
+    }
+    // Flat (CSR) storage of the coefficients: column i has the constraints constrs[begin[i]] to constrs[begin[i + 1] - 1]
+    vector<int> begin(nb_new_cols + 1, 0);
+    for (int i = 0; i < nb_new_cols; i++) {
+        begin[i + 1] = begin[i] + cols[i]->customers.size() + 1;  // +1 for the theta constraint
+        if (!facility_constrs.empty()) {
+            begin[i + 1]++;  // and the facility constraint
+        }
+    }
+    vector<GRBConstr> constrs(begin[nb_new_cols]);
+    vector<double> coeffs(begin[nb_new_cols], 1.0);
+    vector<double> lb(nb_new_cols, 0.0);
+    vector<double> ub(nb_new_cols, 1.0);
+    vector<double> costs(nb_new_cols);
+    vector<char> types(nb_new_cols, GRB_CONTINUOUS);
+    vector<string> names(name_vars ? nb_new_cols : 0);
+    vector<GRBColumn> grb_cols(nb_new_cols);
+    for (int i = 0; i < nb_new_cols; i++) {
+        const Column& col = *cols[i];
+        int k = begin[i];
+        for (int c : col.customers) {
+            constrs[k++] = pi_constrs[c];
+        }
+        constrs[k++] = theta_constr;
+        if (!facility_constrs.empty()) {
+            constrs[k] = facility_constrs[col.facility];
+        }
+        costs[i] = col.cost(inst);
+        model_cols.add(col, costs[i]);
+        grb_cols[i].addTerms(coeffs.data() + begin[i], constrs.data() + begin[i], begin[i + 1] - begin[i]);
+        if (name_vars) {
+            names[i] = "facility " + to_string(col.facility) + " has customers";
+            for (int c : col.customers) {
+                names[i] += " " + to_string(c);
+            }
+        }
+    }
+    GRBVar* vars = model->addVars(lb.data(), ub.data(), costs.data(), types.data(), name_vars ? names.data() : nullptr, grb_cols.data(), nb_new_cols);
+    lambda.insert(lambda.end(), vars, vars + nb_new_cols);
+    delete[] vars;
+    col_age.resize(lambda.size(), 0);
+    return nb_new_cols;
+}
+
+void ColGenModel::updateColumnAges() {
+    double* reduced_costs = model->get(GRB_DoubleAttr_RC, lambda.data(), lambda.size());
+    for (int i = 0; i < lambda.size(); i++) {
+        // Basic columns have a reduced cost of 0, so only nonbasic columns can get older
+        if (reduced_costs[i] > purge_rc_threshold) {
+            col_age[i]++;
+        } else {
+            col_age[i] = 0;
+        }
+    }
+    delete[] reduced_costs;
+}
+
+int ColGenModel::purgeColumns() {
+    // Compact the column vectors, keeping the order of the remaining columns
+    int nb_kept = 0;
+    vector<char> keep(lambda.size(), 1);
+    for (int i = 0; i < lambda.size(); i++) {
+        if (col_age[i] >= purge_max_age) {
+            model->remove(lambda[i]);
+            inactive_cols.push_back(model_cols[i].toColumn());
+            keep[i] = 0;
+            continue;
+        }
+        lambda[nb_kept] = lambda[i];
+        col_age[nb_kept] = col_age[i];
+        nb_kept++;
+    }
+    int nb_removed = lambda.size() - nb_kept;
+    if (nb_removed == 0) {
+        return 0;
+    }
+    lambda.resize(nb_kept);
+    model_cols.compact(keep);
+    col_age.resize(nb_kept);
+    model->update();
+    // The pool only contains the columns of the master, so that removed columns can come back if they are generated again
+    column_pool.clear();
+    for (int i = 0; i < model_cols.size(); i++) {
+        column_pool.insert(model_cols.facilities[i], model_cols.customersOf(i));
+    }
+    nb_purged += nb_removed;
+    return nb_removed;
+}
+
+int ColGenModel::reactivateColumns() {
+    if (inactive_cols.empty()) {
+        return 0;
+    }
+    double theta = getTheta();
+    const vector<double>& pi = getPi();
+    const vector<double>& mu = getMu();
+    vector<Column> cols;
+    for (int i = 0; i < inactive_cols.size();) {
+        double rc = -theta - mu[inactive_cols[i].facility];
+        for (int c : inactive_cols[i].customers) {
+            rc += inst.dist(inactive_cols[i].facility, c) - pi[c];
+        }
+        if (rc < -1e-6 && respectsRestrictions(inactive_cols[i].facility, inactive_cols[i].customers)) {
+            // Negative reduced cost: take it out of the inactive pool (swap with the last one)
+            cols.push_back(std::move(inactive_cols[i]));
+            inactive_cols[i] = std::move(inactive_cols.back());
+            inactive_cols.pop_back();
+        } else {
+            i++;
+        }
+    }
+    int nb_added = addColumns(cols);
+    nb_reactivated += nb_added;
+    return nb_added;
+}
+
+void ColGenModel::forceAssignment(int customer, int facility) {
+    if (forced_facility_for_client[customer] != -1) {
+        nb_forced_at_facility[forced_facility_for_client[customer]]--;
+    }
+    forced_facility_for_client[customer] = facility;
+    nb_forced_at_facility[facility]++;
+}
+
+void ColGenModel::forbidAssignment(int customer, int facility) {
+    forbidden_fc[facility * inst.nb_customers + customer] = 1;
+}
+
+bool ColGenModel::isValidColumn(int i) const {
+    return respectsRestrictions(model_cols.facilities[i], model_cols.customersOf(i));
+}
+
+bool ColGenModel::respectsRestrictions(int facility, span<const int> customers) const {
+    int nb_forced_in_col = 0;
+    for (int c : customers) {
+        if (forbidden_fc[facility * inst.nb_customers + c] || (forced_facility_for_client[c] != -1 && forced_facility_for_client[c] != facility)) {
+            return false;
+        }
+        if (forced_facility_for_client[c] == facility) {
+            nb_forced_in_col++;
+        }
+    }
+    // Every customer forced to the facility has to be in the column
+    return nb_forced_in_col == nb_forced_at_facility[facility];
+}
+
+void ColGenModel::applyRestrictions() {
+    vector<double> ub(lambda.size());
+    for (int i = 0; i < lambda.size(); i++) {
+        ub[i] = isValidColumn(i) ? 1.0 : 0.0;
+    }
+    model->set(GRB_DoubleAttr_UB, lambda.data(), ub.data(), lambda.size());
+    model->update();
+}
+
+void ColGenModel::clearRestrictions() {
+    fill(forced_facility_for_client.begin(), forced_facility_for_client.end(), -1);
+    fill(forbidden_fc.begin(), forbidden_fc.end(), 0);
+    fill(nb_forced_at_facility.begin(), nb_forced_at_facility.end(), 0);
+}
+
+void ColGenModel::addArtificialVariables(double cost) {
+    if (!artificials.empty()) {
+        return;
+    }
+    artificials.resize(inst.nb_customers);
+    for (int c = 0; c < inst.nb_customers; c++) {
+        GRBColumn col;
+        col.addTerm(1.0, pi_constrs[c]);
+        artificials[c] = model->addVar(0, GRB_INFINITY, cost, GRB_CONTINUOUS, col, "artificial customer " + to_string(c));
+    }
+    model->update();
+}
+
+bool ColGenModel::usesArtificialVariables() {
+    if (artificials.empty()) {
+        return false;
+    }
+    double* vals = model->get(GRB_DoubleAttr_X, artificials.data(), artificials.size());
+    bool used = false;
+    for (int c = 0; c < inst.nb_customers; c++) {
+        if (vals[c] > 1e-6) {
+            used = true;
+            break;
+        }
+    }
+    delete[] vals;
+    return used;
 }
 
-void ColGenModel::addColumn(Column col) {
-    GRBColumn grb_col;
-    string name = "facility " + to_string(col.facility) + " has customers ";
-    for (int c : col.customers) {
-        grb_col.addTerm(1, pi_constrs[c]);
-        name += to_string(c);
-        name += " ";
+void ColGenModel::addFacilityConstraints() {
+    if (!facility_constrs.empty()) {
+        return;
     }
-    grb_col.addTerm(1, theta_constr);
-    model_cols.push_back(col);
-    lambda.push_back(model->addVar(0, 1, col.cost(inst), GRB_CONTINUOUS, grb_col, name));
+    facility_constrs.resize(inst.nb_potential_facilities);
+    for (int f = 0; f < inst.nb_potential_facilities; f++) {
+        GRBLinExpr expr;
+        if (f < model_cols.cols_of_facility.size()) {
+            for (int i : model_cols.cols_of_facility[f]) {
+                expr += lambda[i];
+            }
+        }
+        facility_constrs[f] = model->addConstr(expr, GRB_LESS_EQUAL, 1, "at most one column for facility " + to_string(f));
+    }
+    model->update();
+    duals_up_to_date = false;
+}
+
+void ColGenModel::resetStabilization() {
+    theta_center = getTheta();
+    pi_center = getPi();
+    best_LB = -numeric_limits<double>::infinity();
 }
 
 double ColGenModel::getTheta() {
@@ -66,60 +333,129 @@ double ColGenModel::getSeparationTheta() {
     return stab_alpha * theta_center + (1 - stab_alpha) * getTheta();
 }
 
-vector<double> ColGenModel::getPi() {
-    vector<double> duals;
-    for (auto& constr : pi_constrs) {
-        duals.push_back(constr.get(GRB_DoubleAttr_Pi));
+const vector<double>& ColGenModel::getPi() {
+    if (!duals_up_to_date) {
+        double* duals = model->get(GRB_DoubleAttr_Pi, pi_constrs.data(), pi_constrs.size());
+        current_pi.assign(duals, duals + pi_constrs.size());
+        delete[] duals;
+        if (!facility_constrs.empty()) {
+            double* mu = model->get(GRB_DoubleAttr_Pi, facility_constrs.data(), facility_constrs.size());
+            current_mu.assign(mu, mu + facility_constrs.size());
+            delete[] mu;
+        }
+        duals_up_to_date = true;
     }
-    return duals;
+    return current_pi;
 }
 
-vector<double> ColGenModel::getSeparationPi() {
-    vector<double> stab_pi(inst.nb_customers);
-    vector<double> current_pi = getPi();
+const vector<double>& ColGenModel::getMu() {
+    getPi();
+    return current_mu;
+}
+
+const vector<double>& ColGenModel::getSeparationPi() {
+    const vector<double>& pi_out = getPi();
+    separation_pi.resize(inst.nb_customers);
     for (int c = 0; c < inst.nb_customers; c++) {
-        stab_pi[c] = stab_alpha * pi_center[c] + (1 - stab_alpha) * current_pi[c];
+        separation_pi[c] = stab_alpha * pi_center[c] + (1 - stab_alpha) * pi_out[c];
     }
-    return stab_pi;
+    return separation_pi;
 }
 
 double ColGenModel::obj() {
     return model->get(GRB_DoubleAttr_ObjVal);
 }
 
+double ColGenModel::lowerBound() {
+    return converged ? obj() : best_LB;
+}
+
 void ColGenModel::optimize() {
     model->set(GRB_IntParam_Method, 0);
     model->optimize();
+    duals_up_to_date = false;
 }
 
-vector<double> ColGenModel::reducedCosts(int facility, vector<double> pi) {
-    vector<double> reduced_costs;
-    double cost;
+vector<double> ColGenModel::reducedCosts(int facility, const vector<double>& pi) {
+    vector<double> reduced_costs(pi.size());
+    reducedCosts(facility, pi, reduced_costs);
+    return reduced_costs;
+}
+
+void ColGenModel::reducedCosts(int facility, const vector<double>& pi, vector<double>& reduced_costs) {
     for (int c = 0; c < pi.size(); c++) {
-        cost = distance(inst.customer_positions[c], inst.facility_positions[facility]);
-        reduced_costs.push_back(cost - pi[c]);
+        reduced_costs[c] = inst.dist(facility, c) - pi[c];
     }
-    return reduced_costs;
 }
 
-pair<double, Column> ColGenModel::pricingSubProblemMIP(int facility, double theta, vector<double> pi) {
-    // Get the reduced costs
-    vector<double> reduced_costs = reducedCosts(facility, pi);
-    // Create pricing model
-    GRBModel pricing_model(env);
-    vector<GRBVar> z(inst.nb_customers);
+void ColGenModel::createPricingModel(int thread_id) {
+    GRBEnv* pricing_env = new GRBEnv(true);
+    if (!verbose) {
+        pricing_env->set(GRB_IntParam_LogToConsole, 0);
+    }
+    pricing_env->set(GRB_IntParam_Threads, 1);  // the facilities are already solved in parallel
+    pricing_env->start();
+    GRBModel* pricing_model = new GRBModel(*pricing_env);
+    vector<double> lb(inst.nb_customers, 0.0);
+    vector<double> ub(inst.nb_customers, 1.0);
+    vector<char> types(inst.nb_customers, GRB_BINARY);
+    GRBVar* vars = pricing_model->addVars(lb.data(), ub.data(), nullptr, types.data(), nullptr, inst.nb_customers);
+    vector<GRBVar> z(vars, vars + inst.nb_customers);
+    delete[] vars;
     GRBLinExpr expr;
     for (int c = 0; c < inst.nb_customers; c++) {
-        z[c] = pricing_model.addVar(0, 1, reduced_costs[c], GRB_BINARY);
         expr += z[c] * inst.customer_demands[c];
     }
-    pricing_model.addConstr(expr, GRB_LESS_EQUAL, inst.facility_capacities[facility], "capacity constraint");
+    pricing_capacities[thread_id] = pricing_model->addConstr(expr, GRB_LESS_EQUAL, 0, "capacity constraint");
+
+    pricing_envs[thread_id] = pricing_env;
+    pricing_models[thread_id] = pricing_model;
+    pricing_vars[thread_id] = z;
+}
+
+pair<double, Column> ColGenModel::pricingSubProblemMIP(int facility, double theta, const vector<double>& pi, int thread_id) {
+    // Each thread has its own model, and each facility is priced by one thread at a time: no locking needed
+    if (pricing_models[thread_id] == nullptr) {
+        createPricingModel(thread_id);
+    }
+    GRBModel* pricing_model = pricing_models[thread_id];
+    const vector<GRBVar>& z = pricing_vars[thread_id];
+    vector<double>& start = pricing_starts[facility];
+    if (start.empty()) {
+        start.assign(inst.nb_customers, 0.0);  // the empty column is always a valid start
+    }
+
+    // Get the reduced costs
+    vector<double> reduced_costs = reducedCosts(facility, pi);
+    // Restrictions: forced customers are always in the column, forbidden ones never
+    vector<double> lb(inst.nb_customers);
+    vector<double> ub(inst.nb_customers);
+    for (int c = 0; c < inst.nb_customers; c++) {
+        int forced_facility = forced_facility_for_client[c];
+        lb[c] = forced_facility == facility ? 1 : 0;
+        ub[c] = (forced_facility != -1 && forced_facility != facility) || forbidden_fc[facility * inst.nb_customers + c] ? 0 : 1;
+        // Keep the last solution as a start (gurobi drops it if it isn't feasible anymore)
+        start[c] = min(max(start[c], lb[c]), ub[c]);
+    }
+    // Update the model with a few bulk calls
+    pricing_capacities[thread_id].set(GRB_DoubleAttr_RHS, inst.facility_capacities[facility]);
+    pricing_model->set(GRB_DoubleAttr_Obj, z.data(), reduced_costs.data(), inst.nb_customers);
+    pricing_model->set(GRB_DoubleAttr_LB, z.data(), lb.data(), inst.nb_customers);
+    pricing_model->set(GRB_DoubleAttr_UB, z.data(), ub.data(), inst.nb_customers);
+    pricing_model->set(GRB_DoubleAttr_Start, z.data(), start.data(), inst.nb_customers);
 
     // Solve the pricing model
-    pricing_model.optimize();
+    pricing_model->optimize();
+    // The customers forced to the facility may not fit in it
+    if (pricing_model->get(GRB_IntAttr_Status) != GRB_OPTIMAL) {
+        return {0, Column()};
+    }
+    double* vals = pricing_model->get(GRB_DoubleAttr_X, z.data(), inst.nb_customers);
+    start.assign(vals, vals + inst.nb_customers);
+    delete[] vals;
 
     // Check if col has negative reduced cost
-    double obj_val = pricing_model.get(GRB_DoubleAttr_ObjVal) - theta;
+    double obj_val = pricing_model->get(GRB_DoubleAttr_ObjVal) - theta;
 
     // If positive (with small allowed rounding error), return blank column
     if (obj_val >= -1e-6) {
@@ -127,7 +463,7 @@ pair<double, Column> ColGenModel::pricingSubProblemMIP(int facility, double thet
     }
     vector<int> col;
     for (int c = 0; c < inst.nb_customers; c++) {
-        if (z[c].get(GRB_DoubleAttr_X) > 0.5) {
+        if (start[c] > 0.5) {
             col.push_back(c);
         }
     }
@@ -135,32 +471,61 @@ pair<double, Column> ColGenModel::pricingSubProblemMIP(int facility, double thet
     return {obj_val, Column(facility, col)};
 }
 
-pair<double, Column> ColGenModel::pricingSubProblemDP(int facility, double theta, vector<double> pi) {
+pair<double, Column> ColGenModel::pricingSubProblemDP(int facility, double theta, const vector<double>& pi, PricingWorkspace& ws) {
     // Get the reduced costs for each customer
-    vector<double> rc = reducedCosts(facility, pi);
+    reducedCosts(facility, pi, ws.rc);
+    const vector<double>& rc = ws.rc;
 
-    int capacity = inst.facility_capacities[facility];
-    // Store the best found reduced costs for each capacity state (from 0 to u_f)
-    // We are minimizing so initialize all with +inf
-    vector<double> RC(capacity + 1, numeric_limits<double>::infinity());
-    RC[0] = 0;  // Initialize
-    // We also have to store which customers are in the best sol for each capacity state
-    vector<vector<bool>> c_in_best_sol(inst.nb_customers, vector<bool>(capacity + 1, false));
-    // For each customer, see if adding it to a state is beneficial
+    // Trimming: only the customers with a negative reduced cost can improve a column (plus the ones forced to this facility)
+    // The states are capped by the total demand of these customers, and everything is divided by the gcd of their demands
+    const char* forbidden = forbidden_fc.data() + facility * inst.nb_customers;
+    vector<int>& kept = ws.kept;
+    kept.clear();
+    int total_demand = 0;
+    int demand_gcd = 0;
     for (int c = 0; c < inst.nb_customers; c++) {
-        int demand = inst.customer_demands[c];
-        double c_rc = rc[c];
-        // Go from end to start
-        for (int state = capacity; state >= demand; state--) {
-            if (RC[state - demand] == numeric_limits<double>::infinity()) {
-                // State not accessible yet
-                continue;
-            }
-            // Beneficial to add customer?
-            if (RC[state - demand] + c_rc < RC[state]) {
-                RC[state] = RC[state - demand] + c_rc;
-                c_in_best_sol[c][state] = true;
+        int forced_facility = forced_facility_for_client[c];
+        // If c is forced to be with a facility that isn't the one here (or can't be with this one), never add it to a col
+        if ((forced_facility != -1 && forced_facility != facility) || forbidden[c]) {
+            continue;
+        }
+        if (forced_facility == facility || rc[c] < 0) {
+            kept.push_back(c);
+            total_demand += inst.customer_demands[c];
+            demand_gcd = gcd(demand_gcd, inst.customer_demands[c]);
+        }
+    }
+    demand_gcd = max(demand_gcd, 1);
+    int capacity = min(inst.facility_capacities[facility], total_demand) / demand_gcd;
+    ws.nb_calls++;
+    ws.nb_customers_total += inst.nb_customers;
+    ws.nb_customers_kept += kept.size();
+    ws.nb_states_total += inst.facility_capacities[facility] + 1;
+    ws.nb_states_kept += capacity + 1;
+
+    // Store the best found reduced costs for each capacity state (from 0 to capacity)
+    // We are minimizing so initialize all with +inf
+    // We also have to store which customers are in the best sol for each capacity state (bit table with one row per kept customer)
+    ws.reset(kept.size(), capacity);
+    vector<double>& RC = ws.RC;
+
+    // For each customer, see if adding it to a state is beneficial (vectorized when the CPU allows it)
+    for (int k = 0; k < kept.size(); k++) {
+        int c = kept[k];
+        int demand = inst.customer_demands[c] / demand_gcd;
+        // If c is forced to be with given facility, it HAS to be in every col
+        if (forced_facility_for_client[c] == facility) {
+            for (int state = capacity; state >= 0; state--) {
+                // If customer can be placed, place it
+                if (state >= demand && RC[state - demand] != numeric_limits<double>::infinity()) {
+                    RC[state] = RC[state - demand] + rc[c];
+                    ws.set(k, state);
+                } else {  // If customer can't be placed, make state inaccessible
+                    RC[state] = numeric_limits<double>::infinity();
+                }
             }
+        } else {  // customer isn't forced or prohibited (normal DP)
+            KnapsackKernel::addItem(RC.data(), ws.row(k), capacity, demand, rc[c]);
         }
     }
 
@@ -180,33 +545,222 @@ pair<double, Column> ColGenModel::pricingSubProblemDP(int facility, double theta
     // Backtrack: find customers in best sol
     int current_state = best_state;
     vector<int> best_customers = {};
-    for (int c = inst.nb_customers - 1; c >= 0; c--) {
-        if (c_in_best_sol[c][current_state]) {
-            best_customers.push_back(c);
-            current_state -= inst.customer_demands[c];
+    for (int k = kept.size() - 1; k >= 0; k--) {
+        if (ws.get(k, current_state)) {
+            best_customers.push_back(kept[k]);
+            current_state -= inst.customer_demands[kept[k]] / demand_gcd;
+        }
+    }
+    reverse(best_customers.begin(), best_customers.end());  // columns are stored with sorted customers
+
+    // KBEST: the other improving end states give other columns (each state is an exact load, so the columns are distinct)
+    if (column_strategy == ColumnStrategy::KBEST && kbest_k > 1) {
+        vector<pair<double, int>> states;
+        for (int state = 0; state < capacity + 1; state++) {
+            if (state != best_state && RC[state] < theta - 1e-6) {
+                states.push_back({RC[state], state});
+            }
+        }
+        int nb_extra = min(kbest_k - 1, (int)states.size());
+        partial_sort(states.begin(), states.begin() + nb_extra, states.end());
+        for (int i = 0; i < nb_extra; i++) {
+            current_state = states[i].second;
+            vector<int> customers;
+            for (int k = kept.size() - 1; k >= 0; k--) {
+                if (ws.get(k, current_state)) {
+                    customers.push_back(kept[k]);
+                    current_state -= inst.customer_demands[kept[k]] / demand_gcd;
+                }
+            }
+            reverse(customers.begin(), customers.end());
+            kbest_cols[facility].push_back(Column(facility, customers));
         }
     }
     // Otherwise return optimal solution
     return {best_rc - theta, Column(facility, best_customers)};
 }
 
+pair<double, Column> ColGenModel::solveSubProblem(int facility, double theta, const vector<double>& pi, int thread_id) {
+    facility_exact[facility] = 1;
+    if (pricing_method == PricingMethod::MIP) {
+        return pricingSubProblemMIP(facility, theta, pi, thread_id);
+    }
+    if (pricing_method == PricingMethod::HYBRID && !force_exact) {
+        // Any improving column is enough: the exact DP is only needed if the heuristic finds nothing
+        pair<double, Column> result = pricingSubProblemGreedy(facility, theta, pi, workspaces[thread_id]);
+        if (result.second.facility != -1) {
+            facility_exact[facility] = 0;
+            return result;
+        }
+    }
+    return pricingSubProblemDP(facility, theta, pi, workspaces[thread_id]);
+}
+
+vector<pair<double, Column>> ColGenModel::solveSubProblems(double theta, const vector<double>& pi) {
+    int nb_facilities = inst.nb_potential_facilities;
+    vector<pair<double, Column>> results(nb_facilities);
+    facility_exact.assign(nb_facilities, 0);
+    kbest_cols.resize(nb_facilities);
+    for (vector<Column>& cols : kbest_cols) {
+        cols.clear();
+    }
+    // Each sub problem only reads the instance and the duals (and the MIP ones have their own gurobi environment),
+    // so they can be solved independently
+    int block_size = pool->size();
+    // The dual of the facility constraint is paid by every column of the facility, like theta
+    const vector<double>& mu = getMu();
+    if (!partial_pricing || force_exact) {
+        if (block_size == 1) {
+            for (int facility = 0; facility < nb_facilities; facility++) {
+                results[facility] = solveSubProblem(facility, theta + mu[facility], pi, 0);
+            }
+        } else {
+            pool->parallelFor(nb_facilities, [&](int facility, int thread_id) { results[facility] = solveSubProblem(facility, theta + mu[facility], pi, thread_id); });
+        }
+    } else {
+        last_facility_rc.resize(nb_facilities, 0.0);
+        // Rotating order, then the facilities that gave the best columns last time first
+        vector<int> order(nb_facilities);
+        for (int i = 0; i < nb_facilities; i++) {
+            order[i] = (rotation_start + i) % nb_facilities;
+        }
+        stable_sort(order.begin(), order.end(), [&](int f1, int f2) { return last_facility_rc[f1] < last_facility_rc[f2]; });
+        // One facility per thread in each block
+        int nb_found = 0;
+        int nb_priced = 0;
+        while (nb_priced < nb_facilities && nb_found < partial_quota) {
+            int block_end = min(nb_facilities, nb_priced + block_size);
+            pool->parallelFor(block_end - nb_priced, [&](int i, int thread_id) {
+                int facility = order[nb_priced + i];
+                results[facility] = solveSubProblem(facility, theta + mu[facility], pi, thread_id);
+            });
+            for (int i = nb_priced; i < block_end; i++) {
+                int facility = order[i];
+                last_facility_rc[facility] = results[facility].first;
+                if (results[facility].second.facility != -1) {
+                    nb_found++;
+                }
+            }
+            nb_priced = block_end;
+        }
+        rotation_start = (rotation_start + nb_priced) % nb_facilities;
+        if (nb_priced < nb_facilities) {
+            nb_partial_rounds++;
+        }
+    }
+    // The lagrangian bound needs the optimal value of every sub problem
+    pricing_exact = find(facility_exact.begin(), facility_exact.end(), 0) == facility_exact.end();
+    force_exact = false;
+    return results;
+}
+
+pair<double, Column> ColGenModel::pricingSubProblemGreedy(int facility, double theta, const vector<double>& pi, PricingWorkspace& ws) {
+    int capacity = inst.facility_capacities[facility];
+    reducedCosts(facility, pi, ws.rc);
+    const vector<double>& rc = ws.rc;
+    const char* forbidden = forbidden_fc.data() + facility * inst.nb_customers;
+
+    // Forced customers are always in the column, the other candidates are the customers with a negative reduced cost
+    vector<char>& in_col = ws.in_col;
+    in_col.assign(inst.nb_customers, 0);
+    vector<int>& candidates = ws.candidates;
+    candidates.clear();
+    int load = 0;
+    double col_rc = 0.0;
+    for (int c = 0; c < inst.nb_customers; c++) {
+        int forced_facility = forced_facility_for_client[c];
+        if (forced_facility == facility) {
+            in_col[c] = 1;
+            load += inst.customer_demands[c];
+            col_rc += rc[c];
+        } else if (forced_facility == -1 && !forbidden[c] && rc[c] < 0) {
+            candidates.push_back(c);
+        }
+    }
+    if (load > capacity) {
+        return {0, Column()};
+    }
+
+    // Greedy: best reduced cost per unit of demand first
+    sort(candidates.begin(), candidates.end(),
+         [&](int c1, int c2) { return rc[c1] * inst.customer_demands[c2] < rc[c2] * inst.customer_demands[c1]; });
+    for (int c : candidates) {
+        if (load + inst.customer_demands[c] <= capacity) {
+            in_col[c] = 1;
+            load += inst.customer_demands[c];
+            col_rc += rc[c];
+        }
+    }
+
+    // Improvement: try to swap each candidate left out with the customer of the column that improves the most
+    // (forced customers are never removed)
+    for (int out : candidates) {
+        if (in_col[out]) {
+            continue;
+        }
+        int best_in = -1;
+        double best_gain = -1e-9;
+        for (int c : candidates) {
+            if (in_col[c] && load - inst.customer_demands[c] + inst.customer_demands[out] <= capacity) {
+                double gain = rc[out] - rc[c];
+                if (gain < best_gain) {
+                    best_gain = gain;
+                    best_in = c;
+                }
+            }
+        }
+        if (best_in != -1) {
+            in_col[best_in] = 0;
+            in_col[out] = 1;
+            load += inst.customer_demands[out] - inst.customer_demands[best_in];
+            col_rc += best_gain;
+        }
+    }
+
+    if (col_rc - theta >= -1e-6) {
+        return {0, Column()};
+    }
+    vector<int> customers;
+    for (int c = 0; c < inst.nb_customers; c++) {
+        if (in_col[c]) {
+            customers.push_back(c);
+        }
+    }
+    return {col_rc - theta, Column(facility, customers)};
+}
+
+double ColGenModel::lagrangianBound(double theta, const vector<double>& pi, const vector<pair<double, Column>>& sub_pbs) const {
+    // dual objective + reduced cost of the best column of each facility (only the negative ones were returned)
+    double LB = inst.nb_max_open_facilities * theta;
+    for (int c = 0; c < inst.nb_customers; c++) {
+        LB += pi[c];
+    }
+    for (const pair<double, Column>& sub_pb : sub_pbs) {
+        if (sub_pb.second.facility != -1) {
+            LB += sub_pb.first;
+        }
+    }
+    // Facility constraints: each facility can give at most one column
+    for (double mu : current_mu) {
+        LB += mu;
+    }
+    return LB;
+}
+
 vector<Column> ColGenModel::pricing() {
     vector<Column> cols;
     vector<double> col_values;
     Column best_col;
     double best_col_value = 0;
-    double obj_val = obj();
     // Calculate duals
     double theta = getTheta();
-    vector<double> pi = getPi();
-    for (int facility = 0; facility < inst.nb_potential_facilities; facility++) {
-        // Solve the sub problem associated with facility (with given method)
-        pair<double, Column> sub_pb;
-        if (pricing_method == PricingMethod::MIP) {
-            sub_pb = pricingSubProblemMIP(facility, theta, pi);
-        } else {
-            sub_pb = pricingSubProblemDP(facility, theta, pi);
-        }
+    const vector<double>& pi = getPi();
+    // Solve the sub problem associated with each facility (with given method)
+    vector<pair<double, Column>> sub_pbs = solveSubProblems(theta, pi);
+    if (pricing_exact) {
+        best_LB = max(best_LB, lagrangianBound(theta, pi, sub_pbs));
+    }
+    for (pair<double, Column>& sub_pb : sub_pbs) {
         if (sub_pb.second.facility == -1) {  // No column was found -> ignore
             continue;
         }
@@ -223,6 +777,12 @@ vector<Column> ColGenModel::pricing() {
         return {};
     }
     // Either return the best column or all of them (depending on what is asked)
+    if (column_strategy == ColumnStrategy::KBEST) {
+        for (const vector<Column>& extra_cols : kbest_cols) {
+            cols.insert(cols.end(), extra_cols.begin(), extra_cols.end());
+        }
+        return cols;
+    }
     if (column_strategy == ColumnStrategy::MULTI) {
         return cols;
     }
@@ -236,36 +796,27 @@ vector<Column> ColGenModel::inOutPricing() {
     double best_col_value = 0;
 
     // Calculate all the different duals
-    double theta_in = theta_center;    // not technically used here but written to make it clearer
-    vector<double> pi_in = pi_center;  // same
+    // (the in duals are theta_center and pi_center)
     double theta_out = getTheta();
-    vector<double> pi_out = getPi();
+    const vector<double>& pi_out = getPi();
     double theta_sep = getSeparationTheta();
-    vector<double> pi_sep = getSeparationPi();
+    const vector<double>& pi_sep = getSeparationPi();
+    const vector<double>& mu = getMu();  // not stabilized
 
-    double sum_pricing_reduced_costs = 0;  // used to check if LB improved and update stabilization center
     bool LB_improved = false;
 
+    // Solve the sub problem associated with each facility (with given method)
+    vector<pair<double, Column>> sub_pbs = solveSubProblems(theta_sep, pi_sep);
     for (int facility = 0; facility < inst.nb_potential_facilities; facility++) {
-        // Solve the sub problem associated with facility (with given method)
-        pair<double, Column> sub_pb;
-        if (pricing_method == PricingMethod::MIP) {
-            sub_pb = pricingSubProblemMIP(facility, theta_sep, pi_sep);
-        } else {
-            sub_pb = pricingSubProblemDP(facility, theta_sep, pi_sep);
-        }
+        pair<double, Column>& sub_pb = sub_pbs[facility];
         if (sub_pb.second.facility == -1) {  // No column was found -> ignore
             continue;
         }
-        // add reduced cost associated with this facility to sum
-        sum_pricing_reduced_costs += sub_pb.first;
-
         //  Calculate reduced cost for normal duals
-        Column col = sub_pb.second;
-        double rc = -theta_out;
-        vector<double> normal_pi = pi_out;
+        const Column& col = sub_pb.second;
+        double rc = -theta_out - mu[facility];
         for (int c : col.customers) {
-            rc += distance(inst.customer_positions[c], inst.facility_positions[facility]) - normal_pi[c];
+            rc += inst.dist(facility, c) - pi_out[c];
         }
         // if reduced cost is negative, add to cols
         if (rc < -1e-6) {
@@ -279,13 +830,12 @@ vector<Column> ColGenModel::inOutPricing() {
             best_col_value = rc;
         }
     }
-    // Update best LB and stabilization center if bound improved
-    double dual_objective_value = 0.0;
-    for (int c = 0; c < inst.nb_customers; c++) {
-        dual_objective_value += pi_sep[c];
+    // Adapt alpha (before moving the center), the subgradient needs every sub problem
+    if (stabilization == Stabilization::ADAPTIVE && pricing_exact) {
+        adaptAlpha(theta_out, pi_out, sub_pbs);
     }
-    dual_objective_value += inst.nb_max_open_facilities * theta_sep;
-    double LB = dual_objective_value + sum_pricing_reduced_costs;
+    // Update best LB and stabilization center if bound improved (only if every sub problem was solved)
+    double LB = pricing_exact ? lagrangianBound(theta_sep, pi_sep, sub_pbs) : -numeric_limits<double>::infinity();
     if (LB > best_LB) {
         best_LB = LB;
         pi_center = pi_sep;
@@ -293,6 +843,21 @@ vector<Column> ColGenModel::inOutPricing() {
         LB_improved = true;
     }
     if (best_col_value == 0) {  // No column found
+        // With partial pricing or HYBRID, some facilities weren't solved exactly: price again with the same duals, exactly this time,
+        // so the lagrangian bound (and the center) can move before a mispricing or the final phase is decided
+        if (!pricing_exact) {
+            force_exact = true;
+            return {Column()};
+        }
+        // Mispricing with adaptive alpha: get closer to the out point each time (until alpha = 0, then it is a normal pricing)
+        if (stabilization == Stabilization::ADAPTIVE && stab_alpha > 0) {
+            if (nb_mispricings == 0) {
+                mispricing_alpha = stab_alpha;
+            }
+            nb_mispricings++;
+            stab_alpha = max(0.0, 1 - (nb_mispricings + 1) * (1 - mispricing_alpha));
+            return {Column()};
+        }
         // if we improved the lagrangian bound but didn't add columns, we don't want to stop the program so
         // return artifial column that indicates to keep going
         if (LB_improved) {
@@ -300,43 +865,231 @@ vector<Column> ColGenModel::inOutPricing() {
         }
         return {};
     }
+    // End of a mispricing sequence: back to the base alpha
+    if (nb_mispricings > 0) {
+        stab_alpha = mispricing_alpha;
+        nb_mispricings = 0;
+    }
     // Either return the best column or all of them (depending on what is asked)
+    if (column_strategy == ColumnStrategy::KBEST) {
+        // The other columns of each facility are also checked with the normal duals
+        for (const vector<Column>& extra_cols : kbest_cols) {
+            for (const Column& col : extra_cols) {
+                double rc = -theta_out - mu[col.facility];
+                for (int c : col.customers) {
+                    rc += inst.dist(col.facility, c) - pi_out[c];
+                }
+                if (rc < -1e-6) {
+                    cols.push_back(col);
+                }
+            }
+        }
+        return cols;
+    }
     if (column_strategy == ColumnStrategy::MULTI) {
         return cols;
     }
     return {best_col};
 }
 
+void ColGenModel::adaptAlpha(double theta_out, const vector<double>& pi_out, const vector<pair<double, Column>>& sub_pbs) {
+    // Subgradient of the lagrangian function at the separation point (columns with a negative reduced cost are taken)
+    // g_c = 1 - number of columns that contain c, g_theta = p - number of columns
+    vector<double> g(inst.nb_customers, 1.0);
+    double g_theta = inst.nb_max_open_facilities;
+    for (const pair<double, Column>& sub_pb : sub_pbs) {
+        if (sub_pb.second.facility == -1) {
+            continue;
+        }
+        for (int c : sub_pb.second.customers) {
+            g[c] -= 1.0;
+        }
+        g_theta -= 1.0;
+    }
+    double direction = g_theta * (theta_out - theta_center);
+    for (int c = 0; c < inst.nb_customers; c++) {
+        direction += g[c] * (pi_out[c] - pi_center[c]);
+    }
+    // During a mispricing sequence, only the base alpha is tuned (stab_alpha is the one reduced by the mispricings)
+    double& alpha = nb_mispricings > 0 ? mispricing_alpha : stab_alpha;
+    if (direction > 0) {  // the bound increases towards the out point: the separation point was too close to the center
+        alpha = max(0.0, alpha - 0.1);
+    } else {
+        alpha = min(0.99, alpha + 0.1 * (1 - alpha));
+    }
+}
+
+void ColGenModel::addBox() {
+    int n = inst.nb_customers;
+    pi_center = getPi();
+    double average_dual = 0.0;
+    for (double pi : pi_center) {
+        average_dual += abs(pi) / n;
+    }
+    box_width = box_width_ratio * average_dual + 1e-3;
+    // box_plus[c] has a coefficient 1 in the constraint of c (pi_c <= its cost), box_minus[c] a coefficient -1 (pi_c >= -its cost)
+    vector<GRBColumn> cols(2 * n);
+    for (int c = 0; c < n; c++) {
+        cols[c].addTerm(1.0, pi_constrs[c]);
+        cols[n + c].addTerm(-1.0, pi_constrs[c]);
+    }
+    vector<double> lb(2 * n, 0.0);
+    vector<double> ub(2 * n, GRB_INFINITY);
+    vector<double> costs(2 * n, 0.0);
+    vector<char> types(2 * n, GRB_CONTINUOUS);
+    GRBVar* vars = model->addVars(lb.data(), ub.data(), costs.data(), types.data(), nullptr, cols.data(), 2 * n);
+    box_plus.assign(vars, vars + n);
+    box_minus.assign(vars + n, vars + 2 * n);
+    delete[] vars;
+    updateBox();
+}
+
+void ColGenModel::updateBox() {
+    int n = inst.nb_customers;
+    vector<double> costs_plus(n);
+    vector<double> costs_minus(n);
+    for (int c = 0; c < n; c++) {
+        costs_plus[c] = pi_center[c] + box_width;
+        costs_minus[c] = -(pi_center[c] - box_width);
+    }
+    model->set(GRB_DoubleAttr_Obj, box_plus.data(), costs_plus.data(), n);
+    model->set(GRB_DoubleAttr_Obj, box_minus.data(), costs_minus.data(), n);
+    model->update();
+}
+
+void ColGenModel::removeBox() {
+    for (int c = 0; c < box_plus.size(); c++) {
+        model->remove(box_plus[c]);
+        model->remove(box_minus[c]);
+    }
+    box_plus.clear();
+    box_minus.clear();
+    model->update();
+}
+
+bool ColGenModel::boxIsActive() {
+    int n = box_plus.size();
+    double* plus = model->get(GRB_DoubleAttr_X, box_plus.data(), n);
+    double* minus = model->get(GRB_DoubleAttr_X, box_minus.data(), n);
+    bool active = false;
+    for (int c = 0; c < n; c++) {
+        if (plus[c] > 1e-6 || minus[c] > 1e-6) {
+            active = true;
+            break;
+        }
+    }
+    delete[] plus;
+    delete[] minus;
+    return active;
+}
+
 int ColGenModel::solve(int time_limit) {
     int nb_cols = 0;
     auto start = chrono::high_resolution_clock::now();
     chrono::duration<double> time_elapsed = chrono::high_resolution_clock::now() - start;
     bool final_in_out_phase = false;  // Used to fix small errors at the end of the inout stabilization method
+    bool in_out = stabilization == Stabilization::INOUT || stabilization == Stabilization::ADAPTIVE;
+    if (stabilization == Stabilization::BOXSTEP) {
+        addBox();
+        optimize();
+    }
+    vector<double> master_values = {obj()};  // value of the master after each reoptimization (for the tail off)
+    stop_reason = "no column with negative reduced cost";
+    converged = false;
+    trace_time.clear();
+    trace_obj.clear();
+    trace_LB.clear();
+    bool new_solution = true;  // the master was reoptimized since the last aging of the columns
     while (true) {
         time_elapsed = chrono::high_resolution_clock::now() - start;
         if (time_elapsed.count() >= time_limit) {
+            stop_reason = "time limit";
             break;
         }
+        nb_iterations++;
+        if (purge_columns) {
+            // Only age the columns once per solution of the master (not on the iterations that only moved the stabilization center)
+            if (new_solution) {
+                updateColumnAges();
+                new_solution = false;
+            }
+            // Removing variables discards the solution of gurobi: solve again before reading any dual
+            // (the removed columns were nonbasic so the basis is still optimal, this is cheap)
+            if (nb_iterations % purge_frequency == 0 && purgeColumns() > 0) {
+                optimize();
+            }
+            // Cheaper than a pricing: if some removed columns became interesting again, add them back and solve again
+            if (reactivateColumns() > 0) {
+                optimize();
+                new_solution = true;
+                continue;
+            }
+        }
         vector<Column> cols;
-        if (stabilization == Stabilization::NONE || final_in_out_phase) {
+        double previous_LB = best_LB;
+        if (!in_out || final_in_out_phase) {
             cols = pricing();
-        } else if (stabilization == Stabilization::INOUT) {
+        } else {
             cols = inOutPricing();
         }
-        if (cols.empty()) {
-            if (stabilization == Stabilization::INOUT && !final_in_out_phase) {
-                final_in_out_phase = true;
+        if (!box_plus.empty()) {
+            // Boxstep: move the box to the duals that gave a better bound,
+            // or make it bigger if the duals are stuck on it and no column was found
+            bool stuck = cols.empty() && boxIsActive();
+            if (best_LB > previous_LB || stuck) {
+                pi_center = getPi();
+                if (stuck) {
+                    box_width *= 2;
+                }
+                updateBox();
+                nb_recenterings++;
+                // The costs of the box changed, which discards the solution of the master: solve it again before reading it
+                optimize();
+                new_solution = true;
+            }
+            if (stuck) {
                 continue;
             }
+        }
+        time_elapsed = chrono::high_resolution_clock::now() - start;
+        trace_time.push_back(time_elapsed.count());
+        trace_obj.push_back(obj());
+        trace_LB.push_back(best_LB);
+        // The master value is an upper bound of the LP, stop if it is close enough to the lagrangian bound
+        // (not with the box: the slack variables make the master cheaper)
+        if (gap_tolerance > 0 && box_plus.empty() && (obj() - best_LB) <= gap_tolerance * abs(obj())) {
+            stop_reason = "gap tolerance";
             break;
         }
-        if (cols[0].facility == -1) {  // Means that we didn't add any column but that stabilization center was updated so do pricing again
+        if (!cols.empty() && cols[0].facility == -1) {  // Means that we didn't add any column but that stabilization center was updated so do pricing again
             continue;
         }
-        for (Column col : cols) {
-            addColumn(col);
-            nb_cols++;
+        // Columns already in the master are rejected by the pool (can only happen because of rounding errors)
+        int nb_added = cols.empty() ? 0 : addColumns(cols);
+        if (nb_added == 0) {
+            if (in_out && !final_in_out_phase) {
+                final_in_out_phase = true;
+                continue;
+            }
+            converged = true;
+            break;
+        }
+        nb_cols += nb_added;
+        optimize();
+        new_solution = true;
+        // Tail off: the master didn't improve enough during the last iterations
+        master_values.push_back(obj());
+        if (tail_off_iterations > 0 && master_values.size() > tail_off_iterations) {
+            double old_value = master_values[master_values.size() - 1 - tail_off_iterations];
+            if (old_value - obj() <= tail_off_epsilon * abs(old_value)) {
+                stop_reason = "tail off";
+                break;
+            }
         }
+    }
+    // The master is left without the slack variables of the box
+    if (!box_plus.empty()) {
+        removeBox();
         optimize();
     }
     time_elapsed = chrono::high_resolution_clock::now() - start;
@@ -344,6 +1097,90 @@ int ColGenModel::solve(int time_limit) {
     return nb_cols;
 }
 
+double ColGenModel::priceAndBranch(int time_limit, const Solution* incumbent, Solution* sol) {
+    // Columns of the incumbent (one per open facility), added to the master if they aren't in it
+    vector<Column> incumbent_cols;
+    if (incumbent != nullptr) {
+        vector<vector<int>> customers_of_facility(inst.nb_potential_facilities);
+        for (int c = 0; c < incumbent->size(); c++) {
+            if ((*incumbent)[c] >= 0) {
+                customers_of_facility[(*incumbent)[c]].push_back(c);
+            }
+        }
+        for (int f = 0; f < inst.nb_potential_facilities; f++) {
+            if (!customers_of_facility[f].empty()) {
+                incumbent_cols.push_back(Column(f, customers_of_facility[f]));
+            }
+        }
+        addColumns(incumbent_cols);
+    }
+    model->update();
+
+    // Copy of the model where the columns are binary (variables of the copy are in the same order)
+    GRBModel mip(*model);
+    GRBVar* all_vars = mip.getVars();
+    vector<GRBVar> vars(lambda.size());
+    for (int i = 0; i < lambda.size(); i++) {
+        vars[i] = all_vars[lambda[i].index()];
+    }
+    vector<char> types(lambda.size(), GRB_BINARY);
+    vector<double> ub(lambda.size(), 1.0);
+    mip.set(GRB_CharAttr_VType, vars.data(), types.data(), vars.size());
+    mip.set(GRB_DoubleAttr_UB, vars.data(), ub.data(), vars.size());
+    if (!artificials.empty()) {
+        vector<GRBVar> mip_artificials(artificials.size());
+        for (int c = 0; c < artificials.size(); c++) {
+            mip_artificials[c] = all_vars[artificials[c].index()];
+        }
+        vector<double> zeros(artificials.size(), 0.0);
+        mip.set(GRB_DoubleAttr_UB, mip_artificials.data(), zeros.data(), zeros.size());
+    }
+    delete[] all_vars;
+    // In the LP two columns of the same facility can be used together, not in an integer solution (the capacity could be exceeded)
+    // (already in the copy if the master has the facility constraints)
+    for (const vector<int>& cols : model_cols.cols_of_facility) {
+        if (cols.size() < 2 || !facility_constrs.empty()) {
+            continue;
+        }
+        vector<GRBVar> facility_vars(cols.size());
+        for (int k = 0; k < cols.size(); k++) {
+            facility_vars[k] = vars[cols[k]];
+        }
+        vector<double> ones(cols.size(), 1.0);
+        GRBLinExpr expr;
+        expr.addTerms(ones.data(), facility_vars.data(), facility_vars.size());
+        mip.addConstr(expr, GRB_LESS_EQUAL, 1);
+    }
+
+    // Start from the incumbent
+    if (!incumbent_cols.empty()) {
+        vector<double> start(lambda.size(), 0.0);
+        for (const Column& col : incumbent_cols) {
+            start[column_pool.find(col.facility, col.customers)] = 1.0;
+        }
+        mip.set(GRB_DoubleAttr_Start, vars.data(), start.data(), vars.size());
+    }
+
+    mip.set(GRB_DoubleParam_TimeLimit, time_limit);
+    mip.optimize();
+    if (mip.get(GRB_IntAttr_SolCount) == 0) {
+        return numeric_limits<double>::infinity();
+    }
+    if (sol != nullptr) {
+        sol->assign(inst.nb_customers, -1);
+        double* vals = mip.get(GRB_DoubleAttr_X, vars.data(), vars.size());
+        for (int i = 0; i < lambda.size(); i++) {
+            if (vals[i] > 0.5) {
+                for (int c : model_cols.customersOf(i)) {
+                    (*sol)[c] = model_cols.facilities[i];
+                }
+            }
+        }
+        delete[] vals;
+    }
+    return mip.get(GRB_DoubleAttr_ObjVal);
+}
+
 void ColGenModel::printResult() {
     int status = model->get(GRB_IntAttr_Status);
     double obj_val = model->get(GRB_DoubleAttr_ObjVal);
@@ -362,9 +1199,42 @@ void ColGenModel::printResult() {
         cerr << "NO FEASIBLE SOLUTION FOUND!" << endl;
         cout << "---------------------------" << endl;
     }
+    cout << "Columns in the master : " << lambda.size() << " (" << column_pool.nb_hits << " duplicates rejected, " << nb_purged << " purged, "
+         << nb_reactivated << " reactivated)" << endl;
+    cout << "Lagrangian bound : " << best_LB << " (gap " << 100 * (obj_val - best_LB) / abs(obj_val) << "%)" << endl;
+    if (partial_pricing) {
+        cout << "Partial pricing : " << nb_partial_rounds << " rounds stopped early (quota of " << partial_quota << " columns)" << endl;
+    }
+    // DP trimming stats, summed over the workspaces of all threads
+    long nb_calls = 0, nb_customers_total = 0, nb_customers_kept = 0, nb_states_total = 0, nb_states_kept = 0;
+    for (const PricingWorkspace& ws : workspaces) {
+        nb_calls += ws.nb_calls;
+        nb_customers_total += ws.nb_customers_total;
+        nb_customers_kept += ws.nb_customers_kept;
+        nb_states_total += ws.nb_states_total;
+        nb_states_kept += ws.nb_states_kept;
+    }
+    if (nb_calls > 0) {
+        cout << "DP trimming : " << nb_calls << " calls, " << 100.0 * nb_customers_kept / nb_customers_total << "% of customers and "
+             << 100.0 * nb_states_kept / nb_states_total << "% of states kept" << endl;
+    }
+    cout << "Stopped because : " << stop_reason << " (" << nb_iterations << " iterations)" << endl;
+    // Bound trace (at most about 20 lines, all of them in verbose mode)
+    int step = verbose ? 1 : max(1, (int)trace_obj.size() / 20);
+    cout << "Bound trace (time, master, lagrangian bound) :" << endl;
+    for (int i = 0; i < trace_obj.size(); i++) {
+        if (i % step == 0 || i + 1 == trace_obj.size()) {
+            cout << "  " << setprecision(4) << trace_time[i] << "s  " << setprecision(6) << trace_obj[i] << "  " << trace_LB[i] << endl;
+        }
+    }
 }
 
 ColGenModel::~ColGenModel() {
-    delete env;
+    delete pool;
+    for (int thread_id = 0; thread_id < pricing_models.size(); thread_id++) {
+        delete pricing_models[thread_id];
+        delete pricing_envs[thread_id];
+    }
     delete model;
+    delete env;
 }
@@ -6,10 +6,10 @@ using namespace std;
 Column::Column() : facility(-1), customers(vector<int>{}) {}
 Column::Column(int facility, vector<int> customers) : facility(facility), customers(customers) {}
 
-double Column::cost(const Instance& inst) {
-    double cost;
+double Column::cost(const Instance& inst) const {
+    double cost = 0.0;
     for (int c : customers) {
-        cost += distance(inst.customer_positions[c], inst.facility_positions[facility]);
+        cost += inst.dist(facility, c);
     }
     return cost;
 }
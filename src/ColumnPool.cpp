@@ -0,0 +1,68 @@
+#include "ColumnPool.hpp"
+
+#include <algorithm>
+using namespace std;
+
+uint64_t ColumnPool::hash(int facility, span<const int> customers) {
+    // FNV-1a on the facility and the customers, then a final mix so close sets don't give close hashes
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = (h ^ (uint64_t)(uint32_t)facility) * 0x100000001b3ULL;
+    for (int c : customers) {
+        h = (h ^ (uint64_t)(uint32_t)c) * 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+bool ColumnPool::contains(const Column& col) const {
+    return contains(col.facility, col.customers);
+}
+
+int ColumnPool::find(int facility, span<const int> customers) const {
+    auto range = entries_of_hash.equal_range(hash(facility, customers));
+    for (auto it = range.first; it != range.second; it++) {
+        int begin = entry_begin[it->second];
+        int end = entry_begin[it->second + 1];
+        if (end - begin == customers.size() + 1 && keys[begin] == facility && equal(customers.begin(), customers.end(), keys.begin() + begin + 1)) {
+            return it->second;
+        }
+    }
+    return -1;
+}
+
+bool ColumnPool::contains(int facility, span<const int> customers) const {
+    return find(facility, customers) != -1;
+}
+
+bool ColumnPool::insert(const Column& col) {
+    if (!is_sorted(col.customers.begin(), col.customers.end())) {
+        Column sorted_col = col;
+        sort(sorted_col.customers.begin(), sorted_col.customers.end());
+        return insert(sorted_col);
+    }
+    return insert(col.facility, col.customers);
+}
+
+bool ColumnPool::insert(int facility, span<const int> customers) {
+    if (contains(facility, customers)) {
+        nb_hits++;
+        return false;
+    }
+    entries_of_hash.emplace(hash(facility, customers), size());
+    keys.push_back(facility);
+    keys.insert(keys.end(), customers.begin(), customers.end());
+    entry_begin.push_back(keys.size());
+    return true;
+}
+
+int ColumnPool::size() const {
+    return entry_begin.size() - 1;
+}
+
+void ColumnPool::clear() {
+    entries_of_hash.clear();
+    keys.clear();
+    entry_begin.assign(1, 0);
+}
@@ -0,0 +1,93 @@
+#include "ColumnStore.hpp"
+
+#include <algorithm>
+using namespace std;
+
+Column ColumnView::toColumn() const {
+    return Column(facility, vector<int>(customers.begin(), customers.end()));
+}
+
+int ColumnStore::size() const {
+    return facilities.size();
+}
+
+void ColumnStore::add(const Column& col, double cost) {
+    customers.insert(customers.end(), col.customers.begin(), col.customers.end());
+    // Customers are kept sorted (so that a column can be searched in a ColumnPool directly from the store)
+    if (!is_sorted(customers.begin() + offsets.back(), customers.end())) {
+        sort(customers.begin() + offsets.back(), customers.end());
+    }
+    offsets.push_back(customers.size());
+    facilities.push_back(col.facility);
+    costs.push_back(cost);
+    indexColumn(size() - 1);
+}
+
+void ColumnStore::indexColumn(int i) {
+    if (facilities[i] >= cols_of_facility.size()) {
+        cols_of_facility.resize(facilities[i] + 1);
+    }
+    cols_of_facility[facilities[i]].push_back(i);
+    for (int c : customersOf(i)) {
+        if (c >= cols_of_customer.size()) {
+            cols_of_customer.resize(c + 1);
+        }
+        cols_of_customer[c].push_back(i);
+    }
+}
+
+bool ColumnStore::contains(int i, int customer) const {
+    span<const int> col_customers = customersOf(i);
+    return binary_search(col_customers.begin(), col_customers.end(), customer);
+}
+
+ColumnView ColumnStore::operator[](int i) const {
+    return ColumnView{facilities[i], customersOf(i), costs[i]};
+}
+
+span<const int> ColumnStore::customersOf(int i) const {
+    return span<const int>(customers.data() + offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+void ColumnStore::compact(const vector<char>& keep) {
+    // Everything is moved to the front in place, so no reallocation is needed
+    int nb_kept = 0;
+    int nb_customers_kept = 0;
+    for (int i = 0; i < size(); i++) {
+        if (!keep[i]) {
+            continue;
+        }
+        int begin = offsets[i];
+        int end = offsets[i + 1];
+        for (int k = begin; k < end; k++) {
+            customers[nb_customers_kept++] = customers[k];
+        }
+        offsets[nb_kept + 1] = nb_customers_kept;
+        facilities[nb_kept] = facilities[i];
+        costs[nb_kept] = costs[i];
+        nb_kept++;
+    }
+    customers.resize(nb_customers_kept);
+    offsets.resize(nb_kept + 1);
+    facilities.resize(nb_kept);
+    costs.resize(nb_kept);
+    // Indices changed, so the inverted index has to be rebuilt
+    for (vector<int>& cols : cols_of_customer) {
+        cols.clear();
+    }
+    for (vector<int>& cols : cols_of_facility) {
+        cols.clear();
+    }
+    for (int i = 0; i < nb_kept; i++) {
+        indexColumn(i);
+    }
+}
+
+void ColumnStore::clear() {
+    customers.clear();
+    offsets.assign(1, 0);
+    facilities.clear();
+    costs.clear();
+    cols_of_customer.clear();
+    cols_of_facility.clear();
+}
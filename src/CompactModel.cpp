@@ -14,6 +14,9 @@
 using namespace std;
 
 CompactModel::CompactModel(const Instance& inst_, bool verbose_) : inst(inst_), verbose(verbose_) {
+    if (!inst.hasDistanceMatrix()) {
+        inst.buildDistanceMatrix();
+    }
     env = new GRBEnv(true);
     if (!verbose) {
         env->set(GRB_IntParam_LogToConsole, 0);
@@ -72,8 +75,7 @@ CompactModel::CompactModel(const Instance& inst_, bool verbose_) : inst(inst_),
     expr = 0;
     for (int f = 0; f < inst.nb_potential_facilities; f++) {
         for (int c = 0; c < inst.nb_customers; c++) {
-            double dist = distance(inst.customer_positions[c], inst.facility_positions[f]);
-            expr += x[f][c] * dist;
+            expr += x[f][c] * inst.dist(f, c);
         }
     }
     objective = expr;
@@ -90,12 +92,11 @@ Solution CompactModel::convertSolution() {
         return Solution();
     }
     // Otherwise, convert and return solution
-    Solution sol;
+    Solution sol(inst.nb_customers, -1);
     for (int c = 0; c < inst.nb_customers; c++) {
         for (int f = 0; f < inst.nb_potential_facilities; f++) {
             if (x[f][c].get(GRB_DoubleAttr_X) > 0.5) {  // Got a bug when == 1 because of rounding errors
-                Point2D assignment = {inst.facility_positions[f]};
-                sol.push_back(assignment);
+                sol[c] = f;
             }
         }
     }
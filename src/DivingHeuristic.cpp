@@ -1,92 +1,25 @@
 #include "DivingHeuristic.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <iomanip>
+#include <random>
 using namespace std;
 
-DivingHeuristic::DivingHeuristic(ColGenModel& model) : model(model) {}
-
-pair<double, Column> DivingHeuristic::pricingSubProblem(int facility, double theta, const vector<double>& pi) {
-    // Get the reduced costs for each customer
-    vector<double> rc = model.reducedCosts(facility, pi);
-
-    int capacity = model.inst.facility_capacities[facility];
-    int nb_customers = model.inst.nb_customers;
-
-    // Store the best found reduced costs for each capacity state (from 0 to u_f)
-    // We are minimizing so initialize all with +inf
-    vector<double> RC(capacity + 1, numeric_limits<double>::infinity());
-    RC[0] = 0;
-    // We also have to store which customers are in the best sol for each capacity state
-    vector<vector<bool>> c_in_best_sol(nb_customers, vector<bool>(capacity + 1, false));
-    // For each customer, see if adding it to a state is beneficial
-    for (int c = 0; c < nb_customers; c++) {
-        // If c is forced to be with a facility that isn't the one here, never add it to a col
-        if (forced_facility_for_client[c] != -1 && forced_facility_for_client[c] != facility) {
-            continue;
-        }
-        int demand = model.inst.customer_demands[c];
-        double c_rc = rc[c];
-
-        // If c is forced to be with given facility, it HAS to be in every col
-        if (forced_facility_for_client[c] == facility) {
-            for (int state = capacity; state >= 0; state--) {
-                // If customer can be placed, place it
-                if (state >= demand && RC[state - demand] != numeric_limits<double>::infinity()) {
-                    RC[state] = RC[state - demand] + c_rc;
-                    c_in_best_sol[c][state] = true;
-                } else {  // If customer can't be placed, make state inaccessible
-                    RC[state] = numeric_limits<double>::infinity();
-                }
-            }
-        } else {  // customer isn't forced or prohibited (same as normal DP)
-            for (int state = capacity; state >= demand; state--) {
-                if (RC[state - demand] != numeric_limits<double>::infinity()) {
-                    if (RC[state - demand] + c_rc < RC[state]) {
-                        RC[state] = RC[state - demand] + c_rc;
-                        c_in_best_sol[c][state] = true;
-                    }
-                }
-            }
-        }
-    }
-
-    // get best RC
-    double best_rc = theta - 1e-6;
-    int best_state = -1;
-    for (int state = 0; state <= capacity; state++) {
-        if (RC[state] < best_rc) {
-            best_rc = RC[state];
-            best_state = state;
-        }
-    }
-    //  If positive, return blank column
-    if (best_state == -1) return {0, Column()};
-
-    // Backtrack: find customers in best sol
-    vector<int> best_customers;
-    int current_state = best_state;
-    for (int c = nb_customers - 1; c >= 0; c--) {
-        if (c_in_best_sol[c][current_state]) {
-            best_customers.push_back(c);
-            current_state -= model.inst.customer_demands[c];
-        }
-    }
-    // Otherwise return optimal solution
-    return {best_rc - theta, Column(facility, best_customers)};
-}
+DivingHeuristic::DivingHeuristic(ColGenModel& model, DivingPolicy policy, double fix_threshold)
+    : model(model), policy(policy), fix_threshold(fix_threshold) {}
 
 vector<Column> DivingHeuristic::pricing() {
     vector<Column> new_cols;
 
     // get duals
     double theta = model.getTheta();
-    vector<double> pi = model.getPi();
+    const vector<double>& pi = model.getPi();
 
-    for (int f = 0; f < model.inst.nb_potential_facilities; f++) {
-        // only difference with normal pricing: use pricing sub problem adapted to diving
-        pair<double, Column> result = pricingSubProblem(f, theta, pi);
+    // the sub problems of the model respect the assignments forced by the dive
+    vector<pair<double, Column>> results = model.solveSubProblems(theta, pi);
 
+    for (pair<double, Column>& result : results) {
         // If valid solution found
         if (result.second.facility != -1) {
             new_cols.push_back(result.second);
@@ -95,78 +28,107 @@ vector<Column> DivingHeuristic::pricing() {
     return new_cols;  // using method MULTI because faster
 }
 
-pair<int, int> DivingHeuristic::getBestFCPair() {
-    // Reconstructing x[f][c] matrix to see "how much" each customer is with each facility
+vector<pair<int, int>> DivingHeuristic::getFCPairsToFix() {
+    // Reconstructing x[f][c] values to see "how much" each customer is with each facility
     int nb_f = model.inst.nb_potential_facilities;
     int nb_c = model.inst.nb_customers;
-    vector<vector<double>> x(nb_f, vector<double>(nb_c, 0.0));
+    x_fc.resize(nb_f * nb_c, 0.0);  // allocated once, then always left at 0 after each call
+    double* vals = model.model->get(GRB_DoubleAttr_X, model.lambda.data(), model.lambda.size());
     for (int i = 0; i < model.lambda.size(); i++) {
-        double val = model.lambda[i].get(GRB_DoubleAttr_X);
-        if (val > 1e-6) {  // Allow for rounding errors
-            Column col = model.model_cols[i];
+        if (vals[i] > 1e-6) {  // Allow for rounding errors
+            ColumnView col = model.model_cols[i];
+            double* x_f = x_fc.data() + col.facility * nb_c;
             for (int c : col.customers) {
-                x[col.facility][c] += val;
+                if (x_f[c] == 0.0) {
+                    touched_fc.push_back(col.facility * nb_c + c);
+                }
+                x_f[c] += vals[i];
             }
         }
     }
-
-    pair<int, int> best_pair = {-1, -1};
-    double best_value = -1.0;
+    delete[] vals;
 
     // Get the pair with biggest value between 0 and 1 (but not 0 or 1!)
-    for (int f = 0; f < nb_f; f++) {
-        for (int c = 0; c < nb_c; c++) {
-            double val = x[f][c];
-            if (val > 1e-4 && val < 1.0 - 1e-4) {  // allow for rounding erros
-                if (val > best_value) {
-                    best_value = val;
-                    best_pair = {f, c};
-                }
+    // (ties are broken by smallest facility then smallest customer)
+    // With the threshold policy, also keep the other pairs above the threshold
+    // With a randomized dive (top_k > 1), the pair is picked at random among the top_k fractional pairs
+    int best_fc = -1;
+    double best_value = -1.0;
+    vector<int> above_threshold;
+    vector<pair<double, int>> candidates;
+    for (int fc : touched_fc) {
+        double val = x_fc[fc];
+        if (val > 1e-4 && val < 1.0 - 1e-4) {  // allow for rounding erros
+            if (val > best_value || (val == best_value && fc < best_fc)) {
+                best_value = val;
+                best_fc = fc;
             }
+            if (top_k > 1) {
+                candidates.push_back({-val, fc});  // sorted by decreasing value then smallest pair
+            }
+            if (policy == DivingPolicy::THRESHOLD && val > fix_threshold) {
+                above_threshold.push_back(fc);
+            }
+        }
+        x_fc[fc] = 0.0;
+    }
+    touched_fc.clear();
+    vector<pair<int, int>> pairs;
+    if (best_fc == -1) {
+        return pairs;
+    }
+    if (candidates.size() > 1) {
+        int k = min(top_k, (int)candidates.size());
+        partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+        best_fc = candidates[uniform_int_distribution<int>(0, k - 1)(rng)].second;
+    }
+    pairs.push_back({best_fc / nb_c, best_fc % nb_c});
+    // A customer is only fixed once per step (with a random pick, the chosen pair can be below the threshold
+    // while another pair of the same customer is above it)
+    for (int fc : above_threshold) {
+        int customer = fc % nb_c;
+        bool already_fixed = false;
+        for (const pair<int, int>& fixed_pair : pairs) {
+            already_fixed = already_fixed || fixed_pair.second == customer;
+        }
+        if (!already_fixed) {
+            pairs.push_back({fc / nb_c, customer});
         }
     }
-    return best_pair;
+    return pairs;
 }
 
 void DivingHeuristic::prohibidCols(int customer, int facility) {
-    int count_removed = 0;
-    // Go through each column and check if it allowed when forcing given customer and facility together
-    for (int i = 0; i < model.lambda.size(); i++) {
-        // If already disabled, skip
-        if (model.lambda[i].get(GRB_DoubleAttr_UB) < 0.5) {
-            continue;
-        }
-        Column col = model.model_cols[i];
-        bool invalid = false;
-        // First scenario:
-        // Column is associated with given facility but the customer is not in it
-        if (col.facility == facility) {
-            bool contains_customer = false;
-            for (int c : col.customers) {
-                if (c == customer) {
-                    contains_customer = true;
-                    break;
-                }
-            }
-            if (!contains_customer) {
-                model.lambda[i].set(GRB_DoubleAttr_UB, 0.0);  // disable column
-                count_removed++;
+    const ColumnStore& store = model.model_cols;
+    // Columns added since the last fix are all valid
+    disabled_col.resize(store.size(), 0);
+    vector<GRBVar> vars;
+    // First scenario:
+    // Column is associated with given facility but the customer is not in it
+    if (facility < store.cols_of_facility.size()) {
+        for (int i : store.cols_of_facility[facility]) {
+            if (!disabled_col[i] && !store.contains(i, customer)) {
+                disabled_col[i] = 1;
+                vars.push_back(model.lambda[i]);
             }
         }
-        // Second scenario:
-        // Column is not associated with given facility but given customer is in it
-        else {
-            for (int c : col.customers) {
-                if (c == customer) {
-                    model.lambda[i].set(GRB_DoubleAttr_UB, 0.0);  // disable column
-                    count_removed++;
-                }
+    }
+    // Second scenario:
+    // Column is not associated with given facility but given customer is in it
+    if (customer < store.cols_of_customer.size()) {
+        for (int i : store.cols_of_customer[customer]) {
+            if (!disabled_col[i] && store.facilities[i] != facility) {
+                disabled_col[i] = 1;
+                vars.push_back(model.lambda[i]);
             }
         }
     }
+    // Disable all the columns at once
+    vector<double> zeros(vars.size(), 0.0);
+    model.model->set(GRB_DoubleAttr_UB, vars.data(), zeros.data(), vars.size());
     model.model->update();  // make sure changes are applied
     // for debugging
-    // cout << "Disabled " << count_removed << " incompatible columns" << endl;
+    // cout << "Disabled " << vars.size() << " incompatible columns" << endl;
 }
 
 Solution DivingHeuristic::convertSolution() {
@@ -174,7 +136,7 @@ Solution DivingHeuristic::convertSolution() {
     for (int i = 0; i < model.lambda.size(); i++) {
         double col_val = model.lambda[i].get(GRB_DoubleAttr_X);
         if (col_val > 0.5) {  // if column is used in current solution
-            Column col = model.model_cols[i];
+            ColumnView col = model.model_cols[i];
             for (int c : col.customers) {
                 if (facility_for_each_customer[c] != -1) {
                     cout << "ERROR: customer " << c << " is assigned to multiple facilities!" << endl;
@@ -183,62 +145,73 @@ Solution DivingHeuristic::convertSolution() {
             }
         }
     }
-    Solution sol;
-    for (int c = 0; c < model.inst.nb_customers; c++) {
-        int f = facility_for_each_customer[c];
-        Point2D assignment = {model.inst.facility_positions[f]};
-        sol.push_back(assignment);
-    }
-    return sol;
+    // Customers without a facility stay at -1 (the checker will refuse the solution)
+    return facility_for_each_customer;
 }
 
 void DivingHeuristic::solve(int time_limit) {
     auto start = chrono::high_resolution_clock::now();
     chrono::duration<double> time_elapsed = chrono::high_resolution_clock::now() - start;
-    forced_facility_for_client.assign(model.inst.nb_customers, -1);
 
     // Solve model
     model.solve(time_limit);
+    root_LP = model.lowerBound();  // the master is only a lower bound if the column generation converged
+    dive();
+
+    time_elapsed = chrono::high_resolution_clock::now() - start;
+    runtime = time_elapsed.count();
+}
+
+bool DivingHeuristic::dive(const atomic<double>* incumbent) {
+    model.clearRestrictions();
+    disabled_col.clear();
+    nb_fixing_steps = 0;
+    nb_fixes = 0;
 
     while (true) {
-        // Find the best customer-facility pair that isn't forced yet
-        pair<int, int> pair = getBestFCPair();
-        if (pair.first == -1) {  // all customers are assigned to a facility
-            break;
+        // The LP value only increases during the dive: stop if we can't do better than the incumbent anymore
+        if (model.model->get(GRB_IntAttr_Status) != GRB_OPTIMAL) {
+            return false;
+        }
+        if (incumbent != nullptr && model.model->get(GRB_DoubleAttr_ObjVal) >= incumbent->load() - 1e-6) {
+            return false;
         }
 
-        int f = pair.first;
-        int c = pair.second;
+        // Find the best customer-facility pairs that aren't forced yet
+        vector<pair<int, int>> pairs = getFCPairsToFix();
+        if (pairs.empty()) {  // all customers are assigned to a facility
+            return true;
+        }
+        nb_fixing_steps++;
 
-        // for debugging:
-        // cout << "Assigning C" << c << " to F" << f << endl;
+        for (auto [f, c] : pairs) {
+            // for debugging:
+            // cout << "Assigning C" << c << " to F" << f << endl;
 
-        // Force client c to be with facility f
-        if (forced_facility_for_client[c] != -1) {  // make sure assignments is valid
-            cout << "ERROR : customer " << c << " is assigned to multiple clients" << endl;
-        }
-        forced_facility_for_client[c] = f;
+            // Force client c to be with facility f
+            if (model.forced_facility_for_client[c] != -1) {  // make sure assignments is valid
+                cout << "ERROR : customer " << c << " is assigned to multiple clients" << endl;
+            }
+            model.forceAssignment(c, f);
 
-        // Remove incompatible columns
-        prohibidCols(c, f);
+            // Remove incompatible columns
+            prohibidCols(c, f);
+            nb_fixes++;
+        }
 
         // Update model
         model.optimize();
 
         // Find best valid columns to add
-        while (true) {
+        while (model.model->get(GRB_IntAttr_Status) == GRB_OPTIMAL) {
             vector<Column> cols = pricing();
-            if (cols.empty()) {
+            // Stop if nothing new was found (columns already in the master are rejected by the pool)
+            if (cols.empty() || model.addColumns(cols) == 0) {
                 break;
             }
-            for (Column& col : cols) {
-                model.addColumn(col);
-            }
             model.optimize();
         }
     }
-    time_elapsed = chrono::high_resolution_clock::now() - start;
-    runtime = time_elapsed.count();
 }
 
 void DivingHeuristic::printResult() {
@@ -256,4 +229,6 @@ void DivingHeuristic::printResult() {
         cerr << "NO FEASIBLE INTEGER SOLUTION FOUND!" << endl;
         cout << "---------------------------" << endl;
     }
+    cout << "Columns in the master : " << model.lambda.size() << " (" << model.column_pool.nb_hits << " duplicates rejected)" << endl;
+    cout << "Diving steps : " << nb_fixing_steps << " (" << nb_fixes << " pairs fixed)" << endl;
 }
@@ -1,11 +1,282 @@
 #include "Instance.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <fstream>
 #include <unordered_set>
 
+#include "BinaryFormat.hpp"
+#include "MappedFile.hpp"
+
 #include "Solution.hpp"
 using namespace std;
 
+void Instance::buildDistanceMatrix(bool single_precision) {
+    size_t size = (size_t)nb_potential_facilities * nb_customers;
+    distance_matrix.clear();
+    distance_matrix_f.clear();
+    if (single_precision) {
+        distance_matrix_f.resize(size);
+    } else {
+        distance_matrix.resize(size);
+    }
+    for (int f = 0; f < nb_potential_facilities; f++) {
+        size_t row = (size_t)f * nb_customers;
+        for (int c = 0; c < nb_customers; c++) {
+            double d = distance(customer_positions[c], facility_positions[f]);
+            if (single_precision) {
+                distance_matrix_f[row + c] = (float)d;
+            } else {
+                distance_matrix[row + c] = d;
+            }
+        }
+    }
+}
+
+namespace {
+
+/**
+ * @brief Small cursor over the content of a file, reads numbers with from_chars (no copy, no locale)
+ */
+struct Parser {
+    const char* current;
+    const char* end;
+
+    void skipSpaces() {
+        while (current < end && (*current == ' ' || *current == '\n' || *current == '\r' || *current == '\t')) {
+            current++;
+        }
+    }
+
+    template <typename T>
+    bool read(T& value) {
+        skipSpaces();
+        auto [ptr, error] = from_chars(current, end, value);
+        if (error != errc()) {
+            return false;
+        }
+        current = ptr;
+        return true;
+    }
+
+    bool atEnd() {
+        skipSpaces();
+        return current == end;
+    }
+};
+}  // namespace
+
+bool Instance::parse(const char* begin, const char* end, bool build_distances) {
+    Parser parser{begin, end};
+    facility_index_of_position.clear();  // never keep the index of a previous instance, even if this one can't be read
+    if (!parser.read(nb_customers) || !parser.read(nb_potential_facilities) || !parser.read(nb_max_open_facilities) ||
+        !parser.read(max_cap_new_depots)) {
+        cerr << "Error: couldn't read the header of the instance" << endl;
+        return false;
+    }
+    if (nb_customers <= 0 || nb_potential_facilities <= 0 || nb_max_open_facilities <= 0 || nb_max_open_facilities > nb_potential_facilities) {
+        cerr << "Error: invalid header (" << nb_customers << " customers, " << nb_potential_facilities << " facilities, " << nb_max_open_facilities
+             << " max open facilities)" << endl;
+        return false;
+    }
+    customer_positions.resize(nb_customers);
+    customer_demands.resize(nb_customers);
+    for (int c = 0; c < nb_customers; c++) {
+        if (!parser.read(customer_positions[c].x) || !parser.read(customer_positions[c].y) || !parser.read(customer_demands[c])) {
+            cerr << "Error: the instance should have " << nb_customers << " customers but customer " << c + 1 << " couldn't be read" << endl;
+            return false;
+        }
+    }
+    facility_positions.resize(nb_potential_facilities);
+    facility_capacities.resize(nb_potential_facilities);
+    for (int f = 0; f < nb_potential_facilities; f++) {
+        if (!parser.read(facility_positions[f].x) || !parser.read(facility_positions[f].y) || !parser.read(facility_capacities[f])) {
+            cerr << "Error: the instance should have " << nb_potential_facilities << " facilities but facility " << f + 1 << " couldn't be read"
+                 << endl;
+            return false;
+        }
+    }
+    if (!parser.atEnd()) {
+        cerr << "Error: the instance has more lines than announced in the header" << endl;
+        return false;
+    }
+    buildFacilityIndex();
+    distance_matrix.clear();
+    distance_matrix_f.clear();
+    if (build_distances) {
+        buildDistanceMatrix();
+    }
+    return true;
+}
+
+namespace {
+
+/**
+ * @brief Copy count values from data + offset to dest, and return the offset of the next array
+ */
+template <typename T>
+size_t readArray(const char* data, size_t offset, T* dest, size_t count) {
+    memcpy(dest, data + offset, count * sizeof(T));
+    return BinaryFormat::align8(offset + count * sizeof(T));
+}
+
+/**
+ * @brief Write count values (padded to a multiple of 8 bytes)
+ */
+template <typename T>
+void writeArray(ofstream& out, const T* values, size_t count) {
+    out.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+    size_t padding = BinaryFormat::align8(count * sizeof(T)) - count * sizeof(T);
+    const char zeros[8] = {};
+    out.write(zeros, padding);
+}
+}  // namespace
+
+bool Instance::parseBinary(const char* data, size_t size, bool build_distances) {
+    using namespace BinaryFormat;
+    InstanceHeader header;
+    facility_index_of_position.clear();  // never keep the index of a previous instance, even if this one can't be read
+    if (size < sizeof(header)) {
+        cerr << "Error: binary instance file is too small" << endl;
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (!hasMagic(header.magic, 4, INSTANCE_MAGIC) || header.version != VERSION) {
+        cerr << "Error: not a binary instance file or unsupported version (" << header.version << ")" << endl;
+        return false;
+    }
+    if (header.nb_customers <= 0 || header.nb_potential_facilities <= 0 || header.nb_max_open_facilities <= 0 ||
+        header.nb_max_open_facilities > header.nb_potential_facilities) {
+        cerr << "Error: invalid header (" << header.nb_customers << " customers, " << header.nb_potential_facilities << " facilities, "
+             << header.nb_max_open_facilities << " max open facilities)" << endl;
+        return false;
+    }
+    size_t nb_c = header.nb_customers;
+    size_t nb_f = header.nb_potential_facilities;
+    bool has_distances = header.flags & HAS_DISTANCES;
+    bool float_distances = header.flags & FLOAT_DISTANCES;
+    // Make sure the file contains everything announced by the header
+    size_t expected_size = sizeof(header) + 2 * align8(nb_c * sizeof(double)) + align8(nb_c * sizeof(int32_t)) +
+                           2 * align8(nb_f * sizeof(double)) + align8(nb_f * sizeof(int32_t));
+    if (has_distances) {
+        expected_size += align8(nb_f * nb_c * (float_distances ? sizeof(float) : sizeof(double)));
+    }
+    if (size < expected_size) {
+        cerr << "Error: binary instance file is truncated (" << size << " bytes instead of " << expected_size << ")" << endl;
+        return false;
+    }
+
+    nb_customers = header.nb_customers;
+    nb_potential_facilities = header.nb_potential_facilities;
+    nb_max_open_facilities = header.nb_max_open_facilities;
+    max_cap_new_depots = header.max_cap_new_depots;
+
+    // Coordinates are stored as separate x and y arrays
+    vector<double> x(max(nb_c, nb_f)), y(max(nb_c, nb_f));
+    size_t offset = sizeof(header);
+    offset = readArray(data, offset, x.data(), nb_c);
+    offset = readArray(data, offset, y.data(), nb_c);
+    customer_positions.resize(nb_c);
+    for (size_t c = 0; c < nb_c; c++) {
+        customer_positions[c] = {x[c], y[c]};
+    }
+    customer_demands.resize(nb_c);
+    offset = readArray(data, offset, customer_demands.data(), nb_c);
+
+    offset = readArray(data, offset, x.data(), nb_f);
+    offset = readArray(data, offset, y.data(), nb_f);
+    facility_positions.resize(nb_f);
+    for (size_t f = 0; f < nb_f; f++) {
+        facility_positions[f] = {x[f], y[f]};
+    }
+    facility_capacities.resize(nb_f);
+    offset = readArray(data, offset, facility_capacities.data(), nb_f);
+    buildFacilityIndex();
+
+    distance_matrix.clear();
+    distance_matrix_f.clear();
+    if (!build_distances) {
+        return true;
+    }
+    if (!has_distances) {
+        buildDistanceMatrix();
+    } else if (float_distances) {
+        distance_matrix_f.resize(nb_f * nb_c);
+        readArray(data, offset, distance_matrix_f.data(), nb_f * nb_c);
+    } else {
+        distance_matrix.resize(nb_f * nb_c);
+        readArray(data, offset, distance_matrix.data(), nb_f * nb_c);
+    }
+    return true;
+}
+
+bool Instance::loadFromFile(const string& file_path, bool build_distances) {
+    MappedFile file;
+    if (!file.open(file_path)) {
+        return false;
+    }
+    if (BinaryFormat::hasMagic(file.data, file.size, BinaryFormat::INSTANCE_MAGIC)) {
+        return parseBinary(file.data, file.size, build_distances);
+    }
+    return parse(file.data, file.data + file.size, build_distances);
+}
+
+bool Instance::saveToFile(const string& file_path, bool binary, bool with_distances) {
+    ofstream out(file_path, binary ? ios::binary : ios::out);
+    if (!out) {
+        cerr << "Error: couldn't open file " << file_path << " for writing" << endl;
+        return false;
+    }
+    if (!binary) {
+        out << *this;
+        return (bool)out;
+    }
+    using namespace BinaryFormat;
+    if (with_distances && !hasDistanceMatrix()) {
+        buildDistanceMatrix();
+    }
+    InstanceHeader header = {};
+    memcpy(header.magic, INSTANCE_MAGIC, 4);
+    header.version = VERSION;
+    header.flags = 0;
+    if (with_distances) {
+        header.flags |= HAS_DISTANCES;
+        if (!distance_matrix_f.empty()) {
+            header.flags |= FLOAT_DISTANCES;
+        }
+    }
+    header.nb_customers = nb_customers;
+    header.nb_potential_facilities = nb_potential_facilities;
+    header.nb_max_open_facilities = nb_max_open_facilities;
+    header.max_cap_new_depots = max_cap_new_depots;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    vector<double> x(max(nb_customers, nb_potential_facilities)), y(max(nb_customers, nb_potential_facilities));
+    for (int c = 0; c < nb_customers; c++) {
+        x[c] = customer_positions[c].x;
+        y[c] = customer_positions[c].y;
+    }
+    writeArray(out, x.data(), nb_customers);
+    writeArray(out, y.data(), nb_customers);
+    writeArray(out, customer_demands.data(), nb_customers);
+    for (int f = 0; f < nb_potential_facilities; f++) {
+        x[f] = facility_positions[f].x;
+        y[f] = facility_positions[f].y;
+    }
+    writeArray(out, x.data(), nb_potential_facilities);
+    writeArray(out, y.data(), nb_potential_facilities);
+    writeArray(out, facility_capacities.data(), nb_potential_facilities);
+    if (with_distances) {
+        if (!distance_matrix_f.empty()) {
+            writeArray(out, distance_matrix_f.data(), distance_matrix_f.size());
+        } else {
+            writeArray(out, distance_matrix.data(), distance_matrix.size());
+        }
+    }
+    return (bool)out;
+}
+
 bool Instance::isFeasible() {
     // Get total customer demand
     double total_demand = 0;
@@ -35,21 +306,25 @@ bool Instance::checker(const Solution& sol) {
         cerr << "The solution should have the same number of customers as the instance!" << endl;
         return false;
     }
-    unordered_set<Point2D, Point2DHash> used_facilities(sol.begin(), sol.end());
-    int nb_used_facilities = used_facilities.size();
-    if (nb_used_facilities > nb_max_open_facilities) {
-        cerr << nb_used_facilities << " facilities are used but only " << nb_max_open_facilities << " are allowed!" << endl;
-        return false;
-    }
     vector<double> demand(nb_potential_facilities, 0.0);
+    vector<bool> used(nb_potential_facilities, false);
+    int nb_used_facilities = 0;
     for (int c = 0; c < nb_customers; c++) {
-        int facility_index = get_facility_index(sol[c]);
-        if (facility_index == -1) {
-            cerr << "Customer " << c + 1 << " is assigned to a facility that doesn't exist! (" << sol[c].x << "," << sol[c].y << ")" << endl;
+        int facility_index = sol[c];
+        if (facility_index < 0 || facility_index >= nb_potential_facilities) {
+            cerr << "Customer " << c + 1 << " is assigned to a facility that doesn't exist! (" << facility_index << ")" << endl;
             return false;
         }
+        if (!used[facility_index]) {
+            used[facility_index] = true;
+            nb_used_facilities++;
+        }
         demand[facility_index] += customer_demands[c];
     }
+    if (nb_used_facilities > nb_max_open_facilities) {
+        cerr << nb_used_facilities << " facilities are used but only " << nb_max_open_facilities << " are allowed!" << endl;
+        return false;
+    }
     for (int f = 0; f < nb_potential_facilities; f++) {
         if (demand[f] > facility_capacities[f]) {
             cerr << "Facility " << f + 1 << " has a capacity of " << facility_capacities[f] << " but has a total demand of " << demand[f] << "!"
@@ -65,23 +340,51 @@ double Instance::objective_value(const Solution& sol) {
     if (!checker(sol)) {
         return numeric_limits<double>::infinity();
     }
+    if (!hasDistanceMatrix()) {
+        buildDistanceMatrix();
+    }
     // For each customer, get the distance with his assigned facility
     double total_cost = 0.0;
     for (int c = 0; c < nb_customers; c++) {
-        total_cost += distance(sol[c], customer_positions[c]);
+        total_cost += dist(sol[c], c);
     }
     return total_cost;
 }
 
+void Instance::buildFacilityIndex() {
+    facility_index_of_position.clear();
+    for (int f = nb_potential_facilities - 1; f >= 0; f--) {  // backwards so duplicates keep the first index
+        facility_index_of_position[facility_positions[f]] = f;
+    }
+}
+
 int Instance::get_facility_index(const Point2D& pos) {
-    // TODO: see if creating a map to make this faster is useful
-    // -> didn't have time
-    for (int f = 0; f < nb_potential_facilities; f++) {
-        if (facility_positions[f] == pos) {
-            return f;
+    auto it = facility_index_of_position.find(pos);
+    if (it == facility_index_of_position.end()) {
+        return -1;
+    }
+    return it->second;
+}
+
+SolutionPositions Instance::toPositions(const Solution& sol) const {
+    SolutionPositions positions(sol.size());
+    for (int c = 0; c < sol.size(); c++) {
+        // Unassigned customers (invalid solution) get a position outside of the map
+        if (sol[c] >= 0 && sol[c] < nb_potential_facilities) {
+            positions[c] = facility_positions[sol[c]];
+        } else {
+            positions[c] = {-1, -1};
         }
     }
-    return -1;
+    return positions;
+}
+
+Solution Instance::fromPositions(const SolutionPositions& positions) {
+    Solution sol(positions.size());
+    for (int c = 0; c < positions.size(); c++) {
+        sol[c] = get_facility_index(positions[c]);
+    }
+    return sol;
 }
 
 void Instance::visualize(const Solution& sol, string instance_name) {
@@ -102,9 +405,10 @@ void Instance::visualize(const Solution& sol, string instance_name) {
     // Create background
     svg << R"("<rect x="0.0" y="0.0" width="800.0" height="800.0" fill ="white" />)";
     // Create a blue dot for each used facility
-    unordered_set<Point2D, Point2DHash> used_facilities(sol.begin(), sol.end());
-    for (const Point2D& facility : used_facilities) {
+    unordered_set<int> used_facilities(sol.begin(), sol.end());
+    for (int f : used_facilities) {
         // The positions are always between 0 and 1 -> we can multiply the value by the size of the image
+        const Point2D& facility = facility_positions[f];
         svg << R"(<circle cx=")" << facility.x * size << R"(" cy=")" << facility.y * size
             << R"(" r="6.0" fill ="blue" stroke="black" stroke-width="1" />)" << endl;
     }
@@ -112,8 +416,9 @@ void Instance::visualize(const Solution& sol, string instance_name) {
     for (int c = 0; c < nb_customers; c++) {
         svg << R"(<circle cx=")" << customer_positions[c].x * size << R"(" cy=")" << customer_positions[c].y * size
             << R"(" r="3.0" fill="red" stroke="black" stroke-width="1" />)" << endl;
-        svg << R"( <line x1=")" << customer_positions[c].x * size << R"(" y1=")" << customer_positions[c].y * size << R"(" x2=")" << sol[c].x * size
-            << R"(" y2=")" << sol[c].y * size << R"(" opacity="0.3" stroke="green" stroke-width="2" />)" << endl;
+        const Point2D& facility = facility_positions[sol[c]];
+        svg << R"( <line x1=")" << customer_positions[c].x * size << R"(" y1=")" << customer_positions[c].y * size << R"(" x2=")" << facility.x * size
+            << R"(" y2=")" << facility.y * size << R"(" opacity="0.3" stroke="green" stroke-width="2" />)" << endl;
     }
 
     // End document
@@ -149,10 +454,12 @@ istream& operator>>(istream& in, Instance& inst) {
     inst.facility_capacities.clear();
     inst.facility_positions.resize(inst.nb_potential_facilities);
     inst.facility_capacities.resize(inst.nb_potential_facilities);
-    for (int f = 0; f < inst.nb_customers; f++) {
+    for (int f = 0; f < inst.nb_potential_facilities; f++) {
         Point2D pos;
         in >> pos.x >> pos.y >> inst.facility_capacities[f];
         inst.facility_positions[f] = pos;
     }
+    inst.buildFacilityIndex();
+    inst.buildDistanceMatrix();
     return in;
 }
@@ -0,0 +1,125 @@
+#include "KnapsackKernel.hpp"
+
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define KNAPSACK_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+using AddItemFunction = void (*)(double*, uint64_t*, int, int, double);
+
+/**
+ * @brief Set the decision bits of the block of states starting at base (bit i of mask is state base + i)
+ * A block can overlap two words of the row
+ */
+inline void setBits(uint64_t* choices, int base, uint64_t mask, int width) {
+    int word = base >> 6;
+    int offset = base & 63;
+    choices[word] |= mask << offset;
+    if (offset + width > 64) {
+        choices[word + 1] |= mask >> (64 - offset);
+    }
+}
+
+#ifdef KNAPSACK_KERNEL_X86
+// NOTE: going from the end to the start, every state only reads smaller states which haven't been updated yet.
+// So loading a whole block of "previous" values before storing the block gives the same result as the scalar loop,
+// even when demand is smaller than the block width.
+// No need to check for +inf either: inf + c_rc is still inf, which is never strictly better.
+
+__attribute__((target("avx2"))) void addItemAVX2(double* RC, uint64_t* choices, int capacity, int demand, double c_rc) {
+    __m256d v_rc = _mm256_set1_pd(c_rc);
+    int state = capacity;
+    for (; state - 3 >= demand; state -= 4) {
+        int base = state - 3;
+        __m256d current = _mm256_loadu_pd(RC + base);
+        __m256d candidate = _mm256_add_pd(_mm256_loadu_pd(RC + base - demand), v_rc);
+        __m256d better = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+        int mask = _mm256_movemask_pd(better);
+        if (mask != 0) {
+            _mm256_storeu_pd(RC + base, _mm256_blendv_pd(current, candidate, better));
+            setBits(choices, base, (uint64_t)mask, 4);
+        }
+    }
+    // Remaining states (less than a block)
+    for (; state >= demand; state--) {
+        if (RC[state - demand] + c_rc < RC[state]) {
+            RC[state] = RC[state - demand] + c_rc;
+            choices[state >> 6] |= uint64_t(1) << (state & 63);
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) void addItemAVX512(double* RC, uint64_t* choices, int capacity, int demand, double c_rc) {
+    __m512d v_rc = _mm512_set1_pd(c_rc);
+    int state = capacity;
+    for (; state - 7 >= demand; state -= 8) {
+        int base = state - 7;
+        __m512d current = _mm512_loadu_pd(RC + base);
+        __m512d candidate = _mm512_add_pd(_mm512_loadu_pd(RC + base - demand), v_rc);
+        __mmask8 better = _mm512_cmp_pd_mask(candidate, current, _CMP_LT_OQ);
+        if (better != 0) {
+            _mm512_mask_storeu_pd(RC + base, better, candidate);
+            setBits(choices, base, (uint64_t)better, 8);
+        }
+    }
+    // Remaining states (less than a block)
+    for (; state >= demand; state--) {
+        if (RC[state - demand] + c_rc < RC[state]) {
+            RC[state] = RC[state - demand] + c_rc;
+            choices[state >> 6] |= uint64_t(1) << (state & 63);
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Choose the best version supported by the CPU
+ */
+AddItemFunction selectImplementation(const char** name) {
+#ifdef KNAPSACK_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "avx512";
+        return addItemAVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return addItemAVX2;
+    }
+#endif
+    *name = "scalar";
+    return KnapsackKernel::addItemScalar;
+}
+
+const char* implementation_name = "";
+const AddItemFunction implementation = selectImplementation(&implementation_name);
+}  // namespace
+
+void KnapsackKernel::addItemScalar(double* RC, uint64_t* choices, int capacity, int demand, double c_rc) {
+    // Go from end to start
+    for (int state = capacity; state >= demand; state--) {
+        if (RC[state - demand] == numeric_limits<double>::infinity()) {
+            // State not accessible yet
+            continue;
+        }
+        // Beneficial to add customer?
+        if (RC[state - demand] + c_rc < RC[state]) {
+            RC[state] = RC[state - demand] + c_rc;
+            choices[state >> 6] |= uint64_t(1) << (state & 63);
+        }
+    }
+}
+
+void KnapsackKernel::addItem(double* RC, uint64_t* choices, int capacity, int demand, double c_rc) {
+    implementation(RC, choices, capacity, demand, c_rc);
+}
+
+const char* KnapsackKernel::implementationName() {
+    return implementation_name;
+}
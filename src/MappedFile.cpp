@@ -0,0 +1,72 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPEDFILE_USE_MMAP
+#endif
+using namespace std;
+
+bool MappedFile::open(const string& file_path) {
+    close();
+#ifdef MAPPEDFILE_USE_MMAP
+    int fd = ::open(file_path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        cerr << "Error: couldn't open file " << file_path << endl;
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+        cerr << "Error: couldn't read file " << file_path << endl;
+        ::close(fd);
+        return false;
+    }
+    size = file_stat.st_size;
+    void* content = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping stays valid
+    if (content == MAP_FAILED) {
+        cerr << "Error: couldn't map file " << file_path << endl;
+        size = 0;
+        return false;
+    }
+    madvise(content, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(content);
+    mapped = true;
+    return true;
+#else
+    // No mmap: read the whole file at once
+    ifstream file(file_path, ios::binary);
+    if (!file) {
+        cerr << "Error: couldn't open file " << file_path << endl;
+        return false;
+    }
+    stringstream content;
+    content << file.rdbuf();
+    buffer = content.str();
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef MAPPEDFILE_USE_MMAP
+    if (mapped) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+    mapped = false;
+    buffer.clear();
+    data = nullptr;
+    size = 0;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
@@ -0,0 +1,85 @@
+#include "ParallelDiving.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+using namespace std;
+
+ParallelDiving::ParallelDiving(ColGenModel& root, int nb_dives, DivingPolicy policy, double fix_threshold)
+    : root(root), nb_dives(nb_dives), policy(policy), fix_threshold(fix_threshold), incumbent_value(numeric_limits<double>::infinity()) {}
+
+bool ParallelDiving::submitSolution(Instance& inst, const Solution& sol) {
+    if (!inst.checker(sol)) {
+        return false;
+    }
+    double value = inst.objective_value(sol);
+    lock_guard<mutex> lock(incumbent_mutex);
+    if (value >= incumbent_value.load()) {
+        return false;
+    }
+    incumbent = sol;
+    incumbent_value.store(value);
+    return true;
+}
+
+void ParallelDiving::solve(int time_limit) {
+    auto start = chrono::high_resolution_clock::now();
+    chrono::duration<double> time_elapsed;
+
+    root.solve(time_limit);
+    root_LP = root.lowerBound();  // the master is only a lower bound if the column generation converged
+
+    // Copies are made one by one here (each one creates its own gurobi environment)
+    vector<ColGenModel*> models(nb_dives);
+    vector<DivingHeuristic*> divers(nb_dives);
+    for (int d = 0; d < nb_dives; d++) {
+        models[d] = root.clone(1);
+        models[d]->model->set(GRB_IntParam_Threads, 1);  // the dives already run in parallel
+        divers[d] = new DivingHeuristic(*models[d], policy, fix_threshold);
+        if (d > 0) {
+            divers[d]->top_k = top_k;
+            divers[d]->rng.seed(d);
+        }
+    }
+
+    atomic<int> finished = 0;
+    atomic<int> aborted = 0;
+    root.pool->parallelFor(nb_dives, [&](int d, int thread_id) {
+        // Nothing can beat a solution with the value of the root relaxation
+        if (incumbent_value.load() <= root_LP + 1e-6 || !divers[d]->dive(&incumbent_value)) {
+            aborted++;
+            return;
+        }
+        finished++;
+        submitSolution(models[d]->inst, divers[d]->convertSolution());
+    });
+    nb_finished = finished;
+    nb_aborted = aborted;
+
+    for (int d = 0; d < nb_dives; d++) {
+        delete divers[d];
+        delete models[d];
+    }
+    time_elapsed = chrono::high_resolution_clock::now() - start;
+    runtime = time_elapsed.count();
+}
+
+void ParallelDiving::printResult() {
+    if (!incumbent.empty()) {
+        cout << "-----------------------" << endl;
+        cout << "INTEGER SOLUTION FOUND!" << endl;
+        cout << "-----------------------" << endl;
+        cout << "Best solution value : " << incumbent_value.load() << " (" << fixed << setprecision(4) << runtime << "s)" << endl;
+        if (root_LP > -numeric_limits<double>::infinity()) {
+            cout << "Root relaxation : " << root_LP << " (gap " << 100 * (incumbent_value.load() - root_LP) / incumbent_value.load() << "%)" << endl;
+        } else {
+            cout << "Root relaxation : no valid bound (the column generation didn't converge)" << endl;
+        }
+    } else {
+        cout << "---------------------------" << endl;
+        cerr << "NO FEASIBLE INTEGER SOLUTION FOUND!" << endl;
+        cout << "---------------------------" << endl;
+    }
+    cout << "Dives : " << nb_dives << " (" << nb_finished << " finished, " << nb_aborted << " stopped early)" << endl;
+}
@@ -0,0 +1,24 @@
+#include "PricingWorkspace.hpp"
+
+#include <algorithm>
+#include <limits>
+using namespace std;
+
+void PricingWorkspace::reserve(int nb_customers, int max_capacity) {
+    int max_nb_words = max_capacity / 64 + 1;
+    rc.resize(nb_customers);
+    RC.resize(max_capacity + 1);
+    choices.resize((size_t)nb_customers * max_nb_words);
+}
+
+void PricingWorkspace::reset(int nb_customers, int capacity) {
+    // Only grows if a bigger sub problem than expected shows up
+    if (RC.size() < capacity + 1 || rc.size() < nb_customers || choices.size() < (size_t)nb_customers * (capacity / 64 + 1)) {
+        reserve(max(nb_customers, (int)rc.size()), capacity);  // rc is already filled by the caller, never shrink it
+    }
+    fill(RC.begin(), RC.begin() + capacity + 1, numeric_limits<double>::infinity());
+    RC[0] = 0;
+    // Rows are packed with the width needed by this capacity, so only the used part has to be cleared
+    nb_words = capacity / 64 + 1;
+    fill(choices.begin(), choices.begin() + (size_t)nb_customers * nb_words, 0);
+}
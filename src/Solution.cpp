@@ -1,32 +1,93 @@
 #include "Solution.hpp"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
+#include "BinaryFormat.hpp"
+#include "Instance.hpp"
+#include "MappedFile.hpp"
 #include "Point2D.hpp"
 using namespace std;
 
 /**
  * @brief Export the solution in a .sol file
  */
-void exportSolution(Solution sol, string sol_name) {
-    ofstream fout("../" + sol_name + ".sol");
-    if (!fout) {
+void exportSolution(const Instance& inst, const Solution& sol, string sol_name, bool binary) {
+    // The files contain the positions of the facilities, not their indices
+    if (!saveSolution(inst.toPositions(sol), "../" + sol_name + (binary ? ".bsol" : ".sol"), binary)) {
         cerr << "Error: couldn't open file for writing" << endl;
-    } else {
+    }
+}
+
+bool saveSolution(const SolutionPositions& sol, const string& file_path, bool binary) {
+    ofstream fout(file_path, binary ? ios::binary : ios::out);
+    if (!fout) {
+        return false;
+    }
+    if (!binary) {
         fout << sol;
-        fout.close();
+        return (bool)fout;
+    }
+    using namespace BinaryFormat;
+    SolutionHeader header = {};
+    memcpy(header.magic, SOLUTION_MAGIC, 4);
+    header.version = VERSION;
+    header.nb_customers = sol.size();
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // Coordinates are stored as separate x and y arrays
+    vector<double> x(sol.size()), y(sol.size());
+    for (int c = 0; c < sol.size(); c++) {
+        x[c] = sol[c].x;
+        y[c] = sol[c].y;
+    }
+    fout.write(reinterpret_cast<const char*>(x.data()), x.size() * sizeof(double));
+    fout.write(reinterpret_cast<const char*>(y.data()), y.size() * sizeof(double));
+    return (bool)fout;
+}
+
+bool loadSolution(const string& file_path, SolutionPositions& sol) {
+    MappedFile file;
+    if (!file.open(file_path)) {
+        return false;
+    }
+    using namespace BinaryFormat;
+    if (!hasMagic(file.data, file.size, SOLUTION_MAGIC)) {
+        // Text file
+        istringstream in(string(file.data, file.size));
+        in >> sol;
+        return true;
+    }
+    SolutionHeader header;
+    if (file.size < sizeof(header)) {
+        cerr << "Error: binary solution file is too small" << endl;
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    size_t nb_c = header.nb_customers;
+    if (header.version != VERSION || header.nb_customers < 0 || file.size < sizeof(header) + 2 * nb_c * sizeof(double)) {
+        cerr << "Error: invalid or truncated binary solution file" << endl;
+        return false;
+    }
+    const double* x = reinterpret_cast<const double*>(file.data + sizeof(header));
+    const double* y = x + nb_c;
+    sol.resize(nb_c);
+    for (size_t c = 0; c < nb_c; c++) {
+        memcpy(&sol[c].x, x + c, sizeof(double));
+        memcpy(&sol[c].y, y + c, sizeof(double));
     }
+    return true;
 }
 
-ostream& operator<<(ostream& out, const Solution& sol) {
+ostream& operator<<(ostream& out, const SolutionPositions& sol) {
     for (int c = 0; c < sol.size(); c++) {
         out << sol[c].x << " " << sol[c].y << "\n";
     }
     return out;
 }
 
-istream& operator>>(istream& in, Solution& sol) {
+istream& operator>>(istream& in, SolutionPositions& sol) {
     sol.clear();
     Point2D p;
     while (in >> p.x >> p.y) {
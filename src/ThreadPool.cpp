@@ -0,0 +1,88 @@
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int nb_threads) {
+    // The calling thread also works, so we only need nb_threads - 1 workers
+    for (int id = 1; id < nb_threads; id++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, id);
+    }
+}
+
+int ThreadPool::size() const {
+    return workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(int n, const function<void(int, int)>& task_) {
+    // Nothing to share: do everything in the calling thread
+    if (workers.empty() || n <= 1) {
+        for (int i = 0; i < n; i++) {
+            task_(i, 0);
+        }
+        return;
+    }
+    {
+        lock_guard<std::mutex> lock(mutex);
+        task = &task_;
+        nb_tasks = n;
+        next_task = 0;
+        nb_running_workers = workers.size();
+        error = nullptr;
+        generation++;
+    }
+    work_available.notify_all();
+    runTasks(0);
+    {
+        unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [&] { return nb_running_workers == 0; });
+        task = nullptr;
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+void ThreadPool::runTasks(int thread_id) {
+    int i;
+    while ((i = next_task.fetch_add(1)) < nb_tasks) {
+        try {
+            (*task)(i, thread_id);
+        } catch (...) {
+            lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::workerLoop(int thread_id) {
+    int seen_generation = 0;
+    while (true) {
+        unique_lock<std::mutex> lock(mutex);
+        work_available.wait(lock, [&] { return stop || generation != seen_generation; });
+        if (stop) {
+            return;
+        }
+        seen_generation = generation;
+        lock.unlock();
+
+        runTasks(thread_id);
+
+        lock.lock();
+        if (--nb_running_workers == 0) {
+            work_done.notify_one();
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work_available.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}